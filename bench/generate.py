@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""Deterministic input generators for every lab.
+
+usage: generate.py <lab> <distribution> <size> [--seed <seed>] > input.txt
+
+<size> is the number of records (lab1), commands (lab2-3), lines (lab4),
+patterns (lab5), queries (lab7), edges (lab8, lab9) or points (cp).
+cp distributions are three-dimensional unless the name ends in -d<dim>.
+cp mixed inputs are for --dynamic: <size> points followed by <size>
+operations, a quarter inserts, a quarter erases of live points and half
+nearest-neighbour queries.
+"""
+
+import argparse
+import random
+import string
+import sys
+
+CHUNK = 1 << 16
+
+
+def _write_lines(out, lines):
+    buffer = []
+    for line in lines:
+        buffer.append(line)
+        if len(buffer) == CHUNK:
+            out.write("\n".join(buffer) + "\n")
+            buffer.clear()
+    if buffer:
+        out.write("\n".join(buffer) + "\n")
+
+
+def _word(rng, alphabet, low, high):
+    return "".join(rng.choice(alphabet) for _ in range(rng.randint(low, high)))
+
+
+def lab1(out, rng, distribution, size):
+    def keys():
+        for i in range(size):
+            if distribution == "uniform":
+                yield rng.randint(0, 65535)
+            elif distribution == "duplicates":
+                yield rng.randint(0, 15)
+            elif distribution == "sorted":
+                yield i * 65536 // size
+            elif distribution == "reversed":
+                yield 65535 - i * 65536 // size
+            else:
+                raise ValueError(distribution)
+
+    _write_lines(out, (f"{key}\t{_word(rng, string.ascii_lowercase, 1, 64)}" for key in keys()))
+
+
+def lab2_3(out, rng, distribution, size):
+    vocabulary = max(16, size // 20)
+    words = [_word(rng, string.ascii_lowercase, 1, 16) for _ in range(vocabulary)]
+
+    if distribution == "sorted":
+        words.sort()
+
+    def pick(i):
+        if distribution == "uniform":
+            return rng.choice(words)
+        if distribution == "zipf":
+            return words[min(int(rng.paretovariate(1.0)) - 1, vocabulary - 1)]
+        if distribution == "sorted":
+            return words[i % vocabulary]
+        raise ValueError(distribution)
+
+    def commands():
+        for i in range(size):
+            kind = rng.random()
+            word = pick(i)
+            if kind < 0.5:
+                yield f"+ {word} {rng.randint(0, 2 ** 64 - 1)}"
+            elif kind < 0.7:
+                yield f"- {word}"
+            else:
+                yield word
+
+    _write_lines(out, commands())
+
+
+def lab4(out, rng, distribution, size):
+    if distribution == "random":
+        vocabulary = ["alpha", "beta", "gamma", "delta", "epsilon", "zeta"]
+        pattern = "alpha beta alpha"
+    elif distribution == "adversarial":
+        vocabulary = ["a"] * 15 + ["b"]
+        pattern = " ".join(["a"] * 8 + ["b"])
+    else:
+        raise ValueError(distribution)
+
+    out.write(pattern + "\n")
+    _write_lines(out, (" ".join(rng.choice(vocabulary) for _ in range(rng.randint(0, 12))) for _ in range(size)))
+
+
+def lab5(out, rng, distribution, size):
+    length = max(1000, min(size, 10 ** 6))
+    if distribution == "random":
+        alphabet = string.ascii_lowercase[:4]
+        text = "".join(rng.choice(alphabet) for _ in range(length))
+    elif distribution == "adversarial":
+        alphabet = "ab"
+        text = "a" * (length - 1) + "b"
+    else:
+        raise ValueError(distribution)
+
+    out.write(text + "\n")
+
+    def patterns():
+        for _ in range(size):
+            if distribution == "adversarial":
+                yield "a" * rng.randint(1, 100) + "b"
+            elif rng.random() < 0.5:
+                start = rng.randrange(length)
+                yield text[start:start + rng.randint(1, 20)]
+            else:
+                yield _word(rng, alphabet, 1, 20)
+
+    _write_lines(out, patterns())
+
+
+def lab7(out, rng, distribution, size):
+    if distribution == "uniform":
+        high = 10 ** 18
+    elif distribution == "small":
+        high = 10 ** 6
+    else:
+        raise ValueError(distribution)
+    _write_lines(out, (str(rng.randint(1, high)) for _ in range(size)))
+
+
+def _graph_edges(rng, distribution, size, directed):
+    vertices = max(2, size // 10 if distribution in ("random", "cycle") else size)
+    order = list(range(1, vertices + 1))
+    rng.shuffle(order)
+
+    def edges():
+        if distribution == "random" or distribution == "cycle":
+            for _ in range(size):
+                a, b = rng.randrange(vertices), rng.randrange(vertices)
+                if directed:
+                    if a == b:
+                        b = (a + 1) % vertices
+                    a, b = min(a, b), max(a, b)
+                yield order[a], order[b]
+            if distribution == "cycle":
+                yield order[vertices - 1], order[0]
+        elif distribution == "chain":
+            for i in range(min(size, vertices - 1)):
+                yield order[i], order[i + 1]
+        elif distribution == "star":
+            for i in range(1, min(size, vertices - 1) + 1):
+                yield order[0], order[i]
+        elif distribution == "singletons":
+            for _ in range(size // 10):
+                a = rng.randrange(vertices - 1)
+                yield order[a], order[a + 1]
+        else:
+            raise ValueError(distribution)
+
+    if distribution in ("random", "cycle"):
+        count = size + (distribution == "cycle")
+    elif distribution in ("chain", "star"):
+        count = min(size, vertices - 1)
+    else:
+        count = size // 10
+    return vertices, count, edges()
+
+
+def _write_graph(out, vertices, count, edges):
+    out.write(f"{vertices} {count}\n")
+    _write_lines(out, (f"{a} {b}" for a, b in edges))
+
+
+def lab8(out, rng, distribution, size):
+    _write_graph(out, *_graph_edges(rng, distribution, size, True))
+
+
+def lab9(out, rng, distribution, size):
+    _write_graph(out, *_graph_edges(rng, distribution, size, False))
+
+
+def cp(out, rng, distribution, size):
+    shape, _, dim = distribution.partition("-d")
+    dim = int(dim) if dim else 3
+    queries = max(1, size // 5)
+
+    def point():
+        return " ".join(f"{rng.uniform(-1e4, 1e4):.3f}" for _ in range(dim))
+
+    def points(count):
+        centers = [[rng.uniform(-1e4, 1e4) for _ in range(dim)] for _ in range(16)]
+        for _ in range(count):
+            if shape in ("uniform", "mixed"):
+                yield point()
+            elif shape == "clustered":
+                center = rng.choice(centers)
+                yield " ".join(f"{rng.gauss(c, 50.0):.3f}" for c in center)
+            else:
+                raise ValueError(distribution)
+
+    def operations():
+        live, next_id = list(range(1, size + 1)), size + 1
+        for _ in range(size):
+            kind = rng.random()
+            if kind < 0.25:
+                live.append(next_id)
+                next_id += 1
+                yield "+ " + point()
+            elif kind < 0.5 and live:
+                slot = rng.randrange(len(live))
+                live[slot], live[-1] = live[-1], live[slot]
+                yield f"- {live.pop()}"
+            else:
+                yield "? " + point()
+
+    out.write(f"{size} {dim}\n")
+    _write_lines(out, points(size))
+    if shape == "mixed":
+        out.write(f"{size}\n")
+        _write_lines(out, operations())
+        return
+    out.write(f"{queries}\n")
+    _write_lines(out, points(queries))
+
+
+GENERATORS = {
+    "lab1": (lab1, ["uniform", "duplicates", "sorted", "reversed"]),
+    "lab2-3": (lab2_3, ["uniform", "zipf", "sorted"]),
+    "lab4": (lab4, ["random", "adversarial"]),
+    "lab5": (lab5, ["random", "adversarial"]),
+    "lab7": (lab7, ["uniform", "small"]),
+    "lab8": (lab8, ["random", "chain", "star", "cycle"]),
+    "lab9": (lab9, ["random", "chain", "star", "singletons"]),
+    "cp": (cp, ["uniform", "clustered", "uniform-d2", "uniform-d8", "uniform-d16", "uniform-d128", "clustered-d128",
+                 "mixed", "mixed-d8"]),
+}
+
+
+def generate(out, lab, distribution, size, seed=0):
+    function, distributions = GENERATORS[lab]
+    if distribution not in distributions:
+        raise ValueError(f"unknown distribution {distribution} for {lab}")
+    function(out, random.Random(f"{lab}/{distribution}/{size}/{seed}"), distribution, size)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("lab", choices=GENERATORS)
+    parser.add_argument("distribution")
+    parser.add_argument("size", type=int)
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+    generate(sys.stdout, args.lab, args.distribution, args.size, args.seed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::fprintf(stderr, "Usage: measure <result file> <timeout seconds> <program> [arguments...]\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto pid = fork();
+    if (pid < 0)
+    {
+        std::perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        alarm(std::atoi(argv[2]));
+        execvp(argv[3], argv + 3);
+        std::perror("exec");
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        std::perror("wait4");
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto result = std::fopen(argv[1], "w");
+    if (result == nullptr)
+    {
+        std::perror("fopen");
+        return 1;
+    }
+    std::fprintf(result, "%.6f %ld %d\n", elapsed.count(), usage.ru_maxrss, WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+    std::fclose(result);
+    return 0;
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Benchmark every lab on generated inputs and record machine-readable results.
+
+usage: run.py [--labs lab1 lab8 ...] [--distributions uniform-d8 ...]
+              [--scales 1e3 1e4 ...] [--output results.jsonl]
+       run.py compare <old.jsonl> <new.jsonl> [--threshold 0.1]
+
+Each lab is compiled with g++ from its main.cpp. It then runs on every
+distribution from generate.py at every scale, once per argument variant
+in VARIANTS. Wall time, throughput, peak RSS and any "name: value"
+figures the program prints to stderr (such as cp --recall) are appended
+as JSON lines to --output, and a table goes to stderr. Runs go through
+the small measure.cpp launcher, so the peak RSS belongs to the program
+alone and not to the Python process that forked it. Generated inputs are
+cached in --workdir, so later runs only time the programs.
+
+compare takes the fastest successful run of each configuration. A
+configuration whose runs all exited non-zero is listed as FAILED, and a
+failure in the new file counts as a regression.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+INDEX = "{index}"
+
+# Command-line variants to run on every distribution of a lab, unless the
+# (lab, distribution) pair has its own entry. INDEX stands for a lab5 index
+# built from the input's text line by the binary under test, which then
+# reads only the patterns.
+VARIANTS = {
+    "lab5": [[], ["--count"], ["--index", INDEX]],
+    "lab7": [["--batch"]],
+    "lab8": [[], ["--threads", "4"], ["--online"]],
+    "lab9": [[], ["--stream"], ["--threads", "4"]],
+    "cp": [[], ["--epsilon", "1", "--recall"], ["--checks", "64", "--trees", "4", "--recall"]],
+    ("cp", "mixed"): [["--dynamic", "--stats"]],
+    ("cp", "mixed-d8"): [["--dynamic", "--stats"]],
+}
+
+METRIC = re.compile(r"([a-z_]+): ([-+0-9.e]+)")
+
+
+def compile_source(name, source, workdir, cxx, flags):
+    binary = os.path.join(workdir, "bin", name)
+    os.makedirs(os.path.dirname(binary), exist_ok=True)
+    subprocess.run([cxx, *flags.split(), "-o", binary, source], check=True)
+    return binary
+
+
+def input_file(lab, distribution, scale, workdir):
+    path = os.path.join(workdir, "inputs", f"{lab}-{distribution}-{scale}.txt")
+    if not os.path.exists(path):
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path + ".tmp", "w") as out:
+            generate.generate(out, lab, distribution, scale)
+        os.replace(path + ".tmp", path)
+    return path
+
+
+def prebuilt_index(binary, path):
+    index, queries = path + ".index", path + ".queries"
+    with open(path, "rb") as stdin:
+        subprocess.run([binary, "--build", index], stdin=stdin, check=True)
+    if not os.path.exists(queries):
+        with open(path, "rb") as source, open(queries + ".tmp", "wb") as out:
+            source.readline()
+            for chunk in iter(lambda: source.read(1 << 20), b""):
+                out.write(chunk)
+        os.replace(queries + ".tmp", queries)
+    return index, queries
+
+
+def measure(launcher, binary, arguments, path, workdir, timeout):
+    report, errors = os.path.join(workdir, "measure.txt"), os.path.join(workdir, "stderr.txt")
+    with open(path, "rb") as stdin, open(errors, "w") as stderr:
+        try:
+            subprocess.run([launcher, report, str(int(timeout)), binary, *arguments], stdin=stdin, stdout=subprocess.DEVNULL, stderr=stderr, check=True)
+        except subprocess.CalledProcessError:
+            return None, 1, None, {}
+    with open(report) as result:
+        seconds, rss, code = result.read().split()
+    with open(errors) as stderr:
+        metrics = {name: float(value) for name, value in METRIC.findall(stderr.read())}
+    return float(seconds), int(code), int(rss) / 1024, metrics
+
+
+def commit():
+    try:
+        return subprocess.run(["git", "-C", ROOT, "rev-parse", "--short", "HEAD"], capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def run(args):
+    labs = args.labs or list(generate.GENERATORS)
+    scales = [int(float(scale)) for scale in args.scales]
+    revision = commit()
+
+    launcher = compile_source("measure", os.path.join(ROOT, "bench", "measure.cpp"), args.workdir, args.cxx, args.cxxflags)
+    with open(args.output, "a") as results:
+        for lab in labs:
+            binary = compile_source(lab, os.path.join(ROOT, lab, "main.cpp"), args.workdir, args.cxx, args.cxxflags)
+            for distribution in generate.GENERATORS[lab][1]:
+                if args.distributions and distribution not in args.distributions:
+                    continue
+                for scale in scales:
+                    path = input_file(lab, distribution, scale, args.workdir)
+                    for variant in VARIANTS.get((lab, distribution), VARIANTS.get(lab, [[]])):
+                        arguments, stdin = variant, path
+                        if INDEX in variant:
+                            index, stdin = prebuilt_index(binary, path)
+                            arguments = [index if argument == INDEX else argument for argument in variant]
+                        label = " ".join(variant)
+                        for repeat in range(args.repeat):
+                            seconds, code, rss, metrics = measure(launcher, binary, arguments, stdin, args.workdir, args.timeout)
+                            if seconds is None:
+                                print(f"{lab:7} {distribution:14} {scale:>10} {label:28} launcher failed", file=sys.stderr)
+                                continue
+                            record = {
+                                "lab": lab,
+                                "distribution": distribution,
+                                "scale": scale,
+                                "args": label,
+                                "repeat": repeat,
+                                "seconds": round(seconds, 4),
+                                "records_per_second": round(scale / seconds, 1) if seconds > 0 else None,
+                                "megabytes_per_second": round(os.path.getsize(stdin) / 2 ** 20 / seconds, 2) if seconds > 0 else None,
+                                "max_rss_mb": round(rss, 1),
+                                "exit_code": code,
+                                "metrics": metrics,
+                                "commit": revision,
+                                "timestamp": int(time.time()),
+                            }
+                            results.write(json.dumps(record) + "\n")
+                            results.flush()
+                            print(f"{lab:7} {distribution:14} {scale:>10} {label:28} {seconds:9.3f}s {rss:9.1f}MB rc={code}"
+                                  f"{''.join(f' {name}={value:g}' for name, value in metrics.items())}", file=sys.stderr)
+
+
+def load(path):
+    best, failed = {}, {}
+    with open(path) as results:
+        for line in results:
+            record = json.loads(line)
+            key = (record["lab"], record["distribution"], record["scale"], record["args"])
+            if record["exit_code"] != 0:
+                failed[key] = record["exit_code"]
+            elif key not in best or record["seconds"] < best[key]["seconds"]:
+                best[key] = record
+    return best, {key: code for key, code in failed.items() if key not in best}
+
+
+def compare(args):
+    (old, old_failed), (new, new_failed) = load(args.old), load(args.new)
+    regressions = 0
+    print(f"{'lab':7} {'distribution':14} {'scale':>10} {'args':28} {'old s':>9} {'new s':>9} {'ratio':>6} {'old MB':>8} {'new MB':>8}")
+    for key in sorted((old.keys() | old_failed.keys()) & (new.keys() | new_failed.keys())):
+        if key in old_failed or key in new_failed:
+            regressions += key in new_failed
+            before = f"rc={old_failed[key]}" if key in old_failed else f"{old[key]['seconds']:.3f}"
+            after = f"rc={new_failed[key]}" if key in new_failed else f"{new[key]['seconds']:.3f}"
+            print(f"{key[0]:7} {key[1]:14} {key[2]:>10} {key[3]:28} {before:>9} {after:>9}  {'FAILED' if key in new_failed else 'FIXED'}")
+            continue
+        before, after = old[key], new[key]
+        ratio = after["seconds"] / before["seconds"] if before["seconds"] > 0 else float("inf")
+        slower = ratio > 1 + args.threshold or after["max_rss_mb"] > before["max_rss_mb"] * (1 + args.threshold)
+        regressions += slower
+        print(f"{key[0]:7} {key[1]:14} {key[2]:>10} {key[3]:28} {before['seconds']:9.3f} {after['seconds']:9.3f} {ratio:6.2f} "
+              f"{before['max_rss_mb']:8.1f} {after['max_rss_mb']:8.1f}{'  REGRESSION' if slower else ''}")
+    return 1 if regressions else 0
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == "compare":
+        parser = argparse.ArgumentParser(prog="run.py compare")
+        parser.add_argument("old")
+        parser.add_argument("new")
+        parser.add_argument("--threshold", type=float, default=0.1)
+        return compare(parser.parse_args(sys.argv[2:]))
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--labs", nargs="*", choices=list(generate.GENERATORS))
+    parser.add_argument("--distributions", nargs="*")
+    parser.add_argument("--scales", nargs="*", default=["1e3", "1e4", "1e5", "1e6"])
+    parser.add_argument("--repeat", type=int, default=1)
+    parser.add_argument("--timeout", type=int, default=600)
+    parser.add_argument("--output", default="results.jsonl")
+    parser.add_argument("--workdir", default=os.path.join(ROOT, "bench", ".work"))
+    parser.add_argument("--cxx", default="g++")
+    parser.add_argument("--cxxflags", default="-std=c++17 -O2 -pthread")
+    run(parser.parse_args())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
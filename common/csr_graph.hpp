@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "instrument.hpp"
+
+// Adjacency lists in compressed sparse row form; each list keeps the input
+// order of its edges. Edges are buffered in pairs, counted and scattered into
+// place. A directed graph whose edge positions fit in Vertex is instead
+// grouped by source in place, which drops half of the edge buffer. With
+// symmetric = true every edge is stored in both directions.
+template<typename Vertex>
+class csr_graph
+{
+private:
+    static constexpr std::size_t STREAMS = 16;
+
+    std::vector<std::size_t> _offsets;
+    std::vector<Vertex> _targets;
+
+    static void prefetch(const Vertex *address) noexcept
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(address, 1);
+#else
+        static_cast<void>(address);
+#endif
+    }
+
+    void group_by_source(std::vector<Vertex> &sources)
+    {
+        auto m = _targets.size();
+        for (std::size_t i = 1; i < _offsets.size(); ++i)
+        {
+            _offsets[i] += _offsets[i - 1];
+        }
+        for (auto &source: sources)
+        {
+            source = static_cast<Vertex>(_offsets[source]++);
+        }
+        for (auto i = _offsets.size() - 1; i > 0; --i)
+        {
+            _offsets[i] = _offsets[i - 1];
+        }
+        _offsets[0] = 0;
+
+        std::size_t position[STREAMS], last[STREAMS];
+        for (std::size_t stream = 0; stream < STREAMS; ++stream)
+        {
+            position[stream] = m * stream / STREAMS;
+            last[stream] = m * (stream + 1) / STREAMS;
+        }
+
+        for (bool busy = true; busy;)
+        {
+            busy = false;
+            for (std::size_t stream = 0; stream < STREAMS; ++stream)
+            {
+                auto i = position[stream];
+                if (i == last[stream])
+                {
+                    continue;
+                }
+                busy = true;
+
+                std::size_t j = sources[i];
+                if (j == i)
+                {
+                    position[stream] = ++i;
+                }
+                else
+                {
+                    std::swap(sources[i], sources[j]);
+                    std::swap(_targets[i], _targets[j]);
+                }
+                if (i != last[stream])
+                {
+                    prefetch(sources.data() + sources[i]);
+                    prefetch(_targets.data() + sources[i]);
+                }
+            }
+        }
+    }
+
+    template<typename Read>
+    void build_by_scatter(std::size_t m, Read &read_edge, bool symmetric)
+    {
+        std::vector<Vertex> edges(2 * m);
+        {
+            INSTRUMENT_PHASE("graph.read");
+            for (std::size_t i = 0; i < edges.size(); i += 2)
+            {
+                read_edge(edges[i], edges[i + 1]);
+            }
+        }
+
+        INSTRUMENT_PHASE("graph.build");
+        _targets.resize(symmetric ? 2 * m : m);
+        for (std::size_t i = 0; i < edges.size(); i += symmetric ? 1 : 2)
+        {
+            _offsets[edges[i]]++;
+        }
+
+        auto n = _offsets.size() - 1;
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            _offsets[i] += _offsets[i - 1];
+        }
+        _offsets[n] = _targets.size();
+
+        for (std::size_t i = edges.size(); i > 0; i -= 2)
+        {
+            if (symmetric)
+            {
+                _targets[--_offsets[edges[i - 1]]] = edges[i - 2];
+            }
+            _targets[--_offsets[edges[i - 2]]] = edges[i - 1];
+        }
+    }
+
+    template<typename Read>
+    void build_in_place(std::size_t m, Read &read_edge)
+    {
+        std::vector<Vertex> sources(m);
+        _targets.resize(m);
+        {
+            INSTRUMENT_PHASE("graph.read");
+            for (std::size_t i = 0; i < m; ++i)
+            {
+                read_edge(sources[i], _targets[i]);
+            }
+        }
+
+        INSTRUMENT_PHASE("graph.build");
+        for (auto source: sources)
+        {
+            _offsets[source + 1]++;
+        }
+        group_by_source(sources);
+    }
+
+public:
+    struct adjacency
+    {
+        const Vertex *first, *last;
+
+        const Vertex *begin() const noexcept
+        {
+            return first;
+        }
+
+        const Vertex *end() const noexcept
+        {
+            return last;
+        }
+    };
+
+    template<typename Read>
+    csr_graph(std::size_t n, std::size_t m, Read read_edge, bool symmetric = false):
+        _offsets(n + 1, 0)
+    {
+        if (symmetric || m > static_cast<std::size_t>(std::numeric_limits<Vertex>::max()))
+        {
+            build_by_scatter(m, read_edge, symmetric);
+        }
+        else
+        {
+            build_in_place(m, read_edge);
+        }
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _offsets.size() - 1;
+    }
+
+    adjacency operator[](std::size_t vertex) const noexcept
+    {
+        return {_targets.data() + _offsets[vertex], _targets.data() + _offsets[vertex + 1]};
+    }
+};
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace fast_io
+{
+    inline constexpr char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    inline bool is_space(char symbol) noexcept
+    {
+        return symbol == ' ' || (symbol >= '\t' && symbol <= '\r');
+    }
+
+    inline bool is_digit(char symbol) noexcept
+    {
+        return symbol >= '0' && symbol <= '9';
+    }
+
+    inline std::uint64_t load_eight(const char *chars) noexcept
+    {
+        std::uint64_t block;
+        std::memcpy(&block, chars, sizeof(block));
+        return block;
+    }
+
+    inline bool eight_digits(std::uint64_t block) noexcept
+    {
+        return ((block & 0xF0F0F0F0F0F0F0F0) | (((block + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+    }
+
+    inline std::uint32_t parse_eight(std::uint64_t block) noexcept
+    {
+        block = ((block & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+        block = ((block & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+        block = ((block & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+        return static_cast<std::uint32_t>(block);
+    }
+
+    class reader
+    {
+    private:
+        static constexpr std::size_t BLOCK_SIZE = 1 << 20;
+
+        std::FILE *_file;
+        std::vector<char> _buffer;
+        std::size_t _begin = 0, _end = 0;
+        bool _eof = false;
+
+        bool refill()
+        {
+            if (_eof)
+            {
+                return false;
+            }
+
+            if (_begin != 0)
+            {
+                std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+                _end -= _begin;
+                _begin = 0;
+            }
+            if (_end == _buffer.size())
+            {
+                _buffer.resize(2 * _buffer.size());
+            }
+
+            auto count = std::fread(_buffer.data() + _end, 1, _buffer.size() - _end, _file);
+            if (count == 0)
+            {
+                _eof = true;
+                return false;
+            }
+            _end += count;
+            return true;
+        }
+
+        bool skip_spaces()
+        {
+            while (true)
+            {
+                while (_begin < _end && is_space(_buffer[_begin]))
+                {
+                    ++_begin;
+                }
+                if (_begin < _end || !refill())
+                {
+                    return _begin < _end;
+                }
+            }
+        }
+
+        std::size_t token_length()
+        {
+            std::size_t length = 0;
+            while (true)
+            {
+                while (_begin + length < _end && !is_space(_buffer[_begin + length]))
+                {
+                    ++length;
+                }
+                if (_begin + length < _end || !refill())
+                {
+                    return length;
+                }
+            }
+        }
+
+    public:
+        explicit reader(std::FILE *file = stdin):
+            _file(file),
+            _buffer(BLOCK_SIZE)
+        {
+        }
+
+        reader(const reader &other) = delete;
+        reader &operator=(const reader &other) = delete;
+
+        template<typename T>
+        std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>, bool> read(T &value)
+        {
+            if (!skip_spaces())
+            {
+                return false;
+            }
+
+            auto length = token_length();
+            auto first = _buffer.data() + _begin;
+            auto last = first + length;
+            bool negative = false;
+            if (first != last && (*first == '-' || *first == '+'))
+            {
+                negative = *first++ == '-';
+            }
+
+            auto digits = first;
+            std::uint64_t result = 0;
+            while (last - first >= 8 && eight_digits(load_eight(first)))
+            {
+                result = result * 100000000 + parse_eight(load_eight(first));
+                first += 8;
+            }
+            while (first != last && is_digit(*first))
+            {
+                result = result * 10 + (*first++ - '0');
+            }
+
+            if (first == digits)
+            {
+                _begin += length;
+                return false;
+            }
+            _begin = first - _buffer.data();
+            value = static_cast<T>(negative ? 0 - result : result);
+            return true;
+        }
+
+        template<typename T>
+        std::enable_if_t<std::is_floating_point_v<T>, bool> read(T &value)
+        {
+            if (!skip_spaces())
+            {
+                return false;
+            }
+
+            auto length = token_length();
+            auto first = _buffer.data() + _begin;
+            auto last = first + length;
+            if (first != last && *first == '+')
+            {
+                ++first;
+            }
+
+            auto [ptr, error] = std::from_chars(first, last, value);
+            if (error == std::errc::result_out_of_range)
+            {
+                std::string token(first, ptr - first);
+                if constexpr (std::is_same_v<T, float>)
+                {
+                    value = std::strtof(token.c_str(), nullptr);
+                }
+                else if constexpr (std::is_same_v<T, double>)
+                {
+                    value = std::strtod(token.c_str(), nullptr);
+                }
+                else
+                {
+                    value = std::strtold(token.c_str(), nullptr);
+                }
+            }
+            else if (error != std::errc())
+            {
+                _begin += length;
+                return false;
+            }
+            _begin = ptr - _buffer.data();
+            return true;
+        }
+
+        bool read(char &symbol)
+        {
+            if (!skip_spaces())
+            {
+                return false;
+            }
+            symbol = _buffer[_begin++];
+            return true;
+        }
+
+        bool read(std::string &word)
+        {
+            if (!skip_spaces())
+            {
+                return false;
+            }
+
+            auto length = token_length();
+            word.assign(_buffer.data() + _begin, length);
+            _begin += length;
+            return true;
+        }
+
+        bool read_line(std::string &line)
+        {
+            line.clear();
+            if (_begin == _end && !refill())
+            {
+                return false;
+            }
+
+            while (true)
+            {
+                auto first = _buffer.data() + _begin;
+                auto found = static_cast<const char *>(std::memchr(first, '\n', _end - _begin));
+                if (found != nullptr)
+                {
+                    line.append(first, found - first);
+                    _begin += found - first + 1;
+                    return true;
+                }
+
+                line.append(first, _end - _begin);
+                _begin = _end;
+                if (!refill())
+                {
+                    return true;
+                }
+            }
+        }
+    };
+
+    class writer
+    {
+    private:
+        static constexpr std::size_t CAPACITY = 1 << 16;
+
+        std::FILE *_file;
+        std::vector<char> _buffer;
+
+        void reserve(std::size_t size)
+        {
+            if (_buffer.size() + size > CAPACITY)
+            {
+                flush();
+            }
+        }
+
+    public:
+        explicit writer(std::FILE *file = stdout):
+            _file(file)
+        {
+            _buffer.reserve(CAPACITY);
+        }
+
+        writer(const writer &other) = delete;
+        writer &operator=(const writer &other) = delete;
+
+        virtual ~writer()
+        {
+            flush();
+        }
+
+        template<typename T>
+        std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>> write(T value)
+        {
+            using unsigned_t = std::make_unsigned_t<T>;
+
+            char digits[24];
+            auto end = digits + sizeof(digits);
+            auto begin = end;
+
+            auto magnitude = static_cast<unsigned_t>(value);
+            bool negative = false;
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (value < 0)
+                {
+                    negative = true;
+                    magnitude = unsigned_t(0) - magnitude;
+                }
+            }
+
+            while (magnitude >= 100)
+            {
+                auto pair = 2 * static_cast<std::size_t>(magnitude % 100);
+                magnitude /= 100;
+                *--begin = DIGIT_PAIRS[pair + 1];
+                *--begin = DIGIT_PAIRS[pair];
+            }
+            if (magnitude >= 10)
+            {
+                auto pair = 2 * static_cast<std::size_t>(magnitude);
+                *--begin = DIGIT_PAIRS[pair + 1];
+                *--begin = DIGIT_PAIRS[pair];
+            }
+            else
+            {
+                *--begin = static_cast<char>('0' + magnitude);
+            }
+            if (negative)
+            {
+                *--begin = '-';
+            }
+
+            reserve(end - begin);
+            _buffer.insert(_buffer.end(), begin, end);
+        }
+
+        void write(char symbol)
+        {
+            reserve(1);
+            _buffer.push_back(symbol);
+        }
+
+        void write(std::string_view text)
+        {
+            reserve(text.size());
+            if (text.size() > CAPACITY)
+            {
+                std::fwrite(text.data(), 1, text.size(), _file);
+                return;
+            }
+            _buffer.insert(_buffer.end(), text.begin(), text.end());
+        }
+
+        void flush()
+        {
+            std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+            _buffer.clear();
+            std::fflush(_file);
+        }
+    };
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#ifdef INSTRUMENT
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace instrument
+{
+    struct counter
+    {
+        const char *name;
+        std::atomic<std::uint64_t> value{0};
+
+        explicit counter(const char *name):
+            name(name)
+        {
+        }
+    };
+
+    struct phase
+    {
+        const char *name;
+        std::atomic<std::uint64_t> nanoseconds{0}, calls{0};
+
+        explicit phase(const char *name):
+            name(name)
+        {
+        }
+    };
+
+    class registry
+    {
+    private:
+        std::mutex _mutex;
+        std::deque<counter> _counters;
+        std::deque<phase> _phases;
+        std::string _format;
+
+        template<typename Item>
+        static Item &find(std::deque<Item> &items, const char *name)
+        {
+            for (auto &item: items)
+            {
+                if (std::strcmp(item.name, name) == 0)
+                {
+                    return item;
+                }
+            }
+            return items.emplace_back(name);
+        }
+
+        void dump_text(std::FILE *file)
+        {
+            for (const auto &item: _phases)
+            {
+                std::fprintf(file, "phase   %-32s %12.6f s %10llu calls\n", item.name, item.nanoseconds.load() * 1e-9, static_cast<unsigned long long>(item.calls.load()));
+            }
+            for (const auto &item: _counters)
+            {
+                std::fprintf(file, "counter %-32s %12llu\n", item.name, static_cast<unsigned long long>(item.value.load()));
+            }
+        }
+
+        void dump_json(std::FILE *file)
+        {
+            std::fprintf(file, "{\"phases\": {");
+            for (std::size_t i = 0; i < _phases.size(); ++i)
+            {
+                std::fprintf(file, "%s\"%s\": {\"seconds\": %.9f, \"calls\": %llu}", i != 0 ? ", " : "", _phases[i].name,
+                             _phases[i].nanoseconds.load() * 1e-9, static_cast<unsigned long long>(_phases[i].calls.load()));
+            }
+            std::fprintf(file, "}, \"counters\": {");
+            for (std::size_t i = 0; i < _counters.size(); ++i)
+            {
+                std::fprintf(file, "%s\"%s\": %llu", i != 0 ? ", " : "", _counters[i].name, static_cast<unsigned long long>(_counters[i].value.load()));
+            }
+            std::fprintf(file, "}}\n");
+        }
+
+    public:
+        explicit registry()
+        {
+            auto value = std::getenv("LAB_PROFILE");
+            if (value != nullptr && std::strcmp(value, "0") != 0)
+            {
+                _format = value;
+            }
+        }
+
+        registry(const registry &other) = delete;
+        registry &operator=(const registry &other) = delete;
+
+        virtual ~registry()
+        {
+            if (_format.empty())
+            {
+                return;
+            }
+
+            if (_format.compare(0, 5, "json:") == 0)
+            {
+                auto file = std::fopen(_format.c_str() + 5, "w");
+                if (file == nullptr)
+                {
+                    std::fprintf(stderr, "ERROR: Can't open %s\n", _format.c_str() + 5);
+                    return;
+                }
+                dump_json(file);
+                std::fclose(file);
+            }
+            else if (_format == "json")
+            {
+                dump_json(stderr);
+            }
+            else
+            {
+                dump_text(stderr);
+            }
+        }
+
+        static registry &instance()
+        {
+            static registry result;
+            return result;
+        }
+
+        bool enabled() const noexcept
+        {
+            return !_format.empty();
+        }
+
+        counter &find_counter(const char *name)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return find(_counters, name);
+        }
+
+        phase &find_phase(const char *name)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return find(_phases, name);
+        }
+    };
+
+    inline bool enabled() noexcept
+    {
+        static const bool result = registry::instance().enabled();
+        return result;
+    }
+
+    class scoped_phase
+    {
+    private:
+        phase *_phase;
+        std::chrono::steady_clock::time_point _start;
+
+    public:
+        explicit scoped_phase(phase &item):
+            _phase(enabled() ? &item : nullptr)
+        {
+            if (_phase != nullptr)
+            {
+                _start = std::chrono::steady_clock::now();
+            }
+        }
+
+        scoped_phase(const scoped_phase &other) = delete;
+        scoped_phase &operator=(const scoped_phase &other) = delete;
+
+        virtual ~scoped_phase()
+        {
+            if (_phase != nullptr)
+            {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+                _phase->nanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+                _phase->calls.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+}
+
+#define INSTRUMENT_CONCAT_IMPL(first, second) first##second
+#define INSTRUMENT_CONCAT(first, second) INSTRUMENT_CONCAT_IMPL(first, second)
+
+#define INSTRUMENT_PHASE(name) \
+    static auto &INSTRUMENT_CONCAT(instrument_phase_, __LINE__) = instrument::registry::instance().find_phase(name); \
+    instrument::scoped_phase INSTRUMENT_CONCAT(instrument_scope_, __LINE__)(INSTRUMENT_CONCAT(instrument_phase_, __LINE__))
+
+#define INSTRUMENT_COUNT(name, amount) \
+    do \
+    { \
+        if (instrument::enabled()) \
+        { \
+            static auto &instrument_counter = instrument::registry::instance().find_counter(name); \
+            instrument_counter.value.fetch_add(amount, std::memory_order_relaxed); \
+        } \
+    } while (false)
+
+#else
+
+#define INSTRUMENT_PHASE(name) static_cast<void>(0)
+#define INSTRUMENT_COUNT(name, amount) static_cast<void>(0)
+
+#endif
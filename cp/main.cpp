@@ -1,177 +1,1360 @@
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
-using ld_t = long double;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-struct point 
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using coord_t = double;
+
+template<std::size_t Dim = 0>
+double squared_distance(const coord_t *a, const coord_t *b, std::size_t dim) noexcept
+{
+    if constexpr (Dim != 0)
+    {
+        dim = Dim;
+    }
+
+    std::size_t i = 0;
+    double sum = 0;
+#if defined(__AVX2__)
+    if (dim >= 4)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (; i + 4 <= dim; i += 4)
+        {
+            __m256d diff = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(diff, diff));
+        }
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+#elif defined(__SSE2__)
+    if (dim >= 2)
+    {
+        __m128d acc = _mm_setzero_pd();
+        for (; i + 2 <= dim; i += 2)
+        {
+            __m128d diff = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+            acc = _mm_add_pd(acc, _mm_mul_pd(diff, diff));
+        }
+        sum = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    }
+#endif
+    for (; i < dim; ++i)
+    {
+        double diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+struct neighbor
+{
+    double distance;
+    std::size_t index;
+
+    bool operator<(const neighbor &other) const noexcept
+    {
+        return distance < other.distance || (distance == other.distance && index < other.index);
+    }
+};
+
+class point_set
 {
-    std::vector<ld_t> coords;
-    std::size_t index = 0;
+    struct file_header
+    {
+        char magic[8];
+        std::uint64_t size, dim, dtype;
+    };
+
+    static constexpr char FILE_MAGIC[8] = {'K', 'D', 'P', 'O', 'I', 'N', 'T', 'S'};
+
+    std::vector<coord_t> _storage;
+    const coord_t *_data = nullptr;
+    std::size_t _size = 0, _dim = 0;
+
+    void *_mapping = nullptr;
+    std::size_t _mapping_size = 0;
+
+    void unmap() noexcept
+    {
+        if (_mapping != nullptr)
+        {
+            munmap(_mapping, _mapping_size);
+            _mapping = nullptr;
+            _mapping_size = 0;
+        }
+    }
+
+public:
+    enum dtype: std::uint64_t
+    {
+        FLOAT64 = 0,
+        FLOAT32 = 1
+    };
+
+    explicit point_set() = default;
+
+    point_set(const point_set &other) = delete;
+    point_set &operator=(const point_set &other) = delete;
+
+    virtual ~point_set()
+    {
+        unmap();
+    }
+
+    const coord_t *data() const noexcept
+    {
+        return _data;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    std::size_t dim() const noexcept
+    {
+        return _dim;
+    }
+
+    void assign(std::vector<coord_t> coords, std::size_t d)
+    {
+        unmap();
+        _storage = std::move(coords);
+        _data = _storage.data();
+        _dim = d;
+        _size = d != 0 ? _storage.size() / d : 0;
+    }
+
+    void save(const std::string &path, dtype type = FLOAT64) const
+    {
+        std::ofstream ofs(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            throw std::runtime_error("Can't open " + path);
+        }
+
+        file_header header;
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.size = _size;
+        header.dim = _dim;
+        header.dtype = type;
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        if (type == FLOAT64)
+        {
+            ofs.write(reinterpret_cast<const char *>(_data), sizeof(double) * _size * _dim);
+        }
+        else
+        {
+            std::vector<float> narrowed(_data, _data + _size * _dim);
+            ofs.write(reinterpret_cast<const char *>(narrowed.data()), sizeof(float) * narrowed.size());
+        }
+
+        ofs.close();
+        if (!ofs)
+        {
+            throw std::runtime_error("Write error");
+        }
+    }
 
-    explicit point(std::vector<ld_t> dims, size_t idx): 
-        coords(std::move(dims)), index(idx) 
+    void load(const std::string &path)
     {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Can't open " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(file_header))
+        {
+            close(fd);
+            throw std::runtime_error("Invalid point file");
+        }
+
+        std::size_t size = info.st_size;
+        auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("Mapping error");
+        }
 
+        auto bytes = static_cast<const char *>(mapping);
+        const auto &header = *reinterpret_cast<const file_header *>(bytes);
+        auto width = header.dtype == FLOAT64 ? sizeof(double) : sizeof(float);
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.dtype > FLOAT32 || header.dim == 0 ||
+            sizeof(file_header) + width * header.size * header.dim != size)
+        {
+            munmap(mapping, size);
+            throw std::runtime_error("Invalid point file");
+        }
+
+        unmap();
+        _size = header.size;
+        _dim = header.dim;
+        if (header.dtype == FLOAT64)
+        {
+            _storage.clear();
+            _mapping = mapping;
+            _mapping_size = size;
+            _data = reinterpret_cast<const coord_t *>(bytes + sizeof(file_header));
+            return;
+        }
+
+        auto narrowed = reinterpret_cast<const float *>(bytes + sizeof(file_header));
+        _storage.assign(narrowed, narrowed + _size * _dim);
+        _data = _storage.data();
+        munmap(mapping, size);
     }
+};
 
-    explicit point() = default;
+struct tree_header
+{
+    char magic[8];
+    std::uint64_t size, dim, bucket_size;
 };
 
-double euclidean_distance(const point &a, const point &b) 
+constexpr char TREE_MAGIC[8] = {'K', 'D', 'T', 'R', 'E', 'E', '0', '1'};
+
+tree_header read_tree_header(std::ifstream &ifs)
 {
-    double sum = 0;
-    for (size_t i = 0; i < a.coords.size(); ++i) 
+    tree_header header;
+    if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC)) != 0 || header.dim == 0)
     {
-        double diff = a.coords[i] - b.coords[i];
-        sum += diff * diff;
+        throw std::runtime_error("Invalid tree file");
+    }
+    return header;
+}
+
+std::size_t tree_file_dimension(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios_base::binary);
+    if (!ifs)
+    {
+        throw std::runtime_error("Can't open " + path);
     }
-    return sqrt(sum);
+    return read_tree_header(ifs).dim;
 }
 
-class kd_tree 
+template<std::size_t Dim = 0>
+class kd_tree
 {
-    struct node 
+    using point_t = std::conditional_t<Dim == 0, coord_t, std::array<coord_t, Dim>>;
+
+    std::vector<point_t> _coords;
+    std::vector<std::size_t> _indices;
+    std::vector<std::size_t> _axes;
+    std::size_t _dim = 0;
+    std::size_t _bucket_size = 0;
+
+    std::size_t dim() const noexcept
     {
-        point pt;
-        std::unique_ptr<node> right = nullptr;
-        std::unique_ptr<node> left = nullptr;
-        explicit node(const point &p): 
-            pt(p) 
+        if constexpr (Dim != 0)
+        {
+            return Dim;
+        }
+        else
         {
+            return _dim;
+        }
+    }
+
+    std::size_t next_axis(std::size_t axis) const noexcept
+    {
+        return axis + 1 != dim() ? axis + 1 : 0;
+    }
 
+    coord_t *coords(std::size_t slot) noexcept
+    {
+        if constexpr (Dim != 0)
+        {
+            return _coords[slot].data();
         }
-    };
-    
-    std::unique_ptr<node> _root = nullptr;
-    int _dim = 0;
+        else
+        {
+            return _coords.data() + slot * _dim;
+        }
+    }
 
-    void build(std::vector<point> &points, int l, int r, std::size_t depth = 0) 
+    const coord_t *coords(std::size_t slot) const noexcept
     {
-        if (l > r) 
+        if constexpr (Dim != 0)
         {
+            return _coords[slot].data();
+        }
+        else
+        {
+            return _coords.data() + slot * _dim;
+        }
+    }
+
+    double distance(std::size_t slot, const coord_t *target) const noexcept
+    {
+        return squared_distance<Dim>(coords(slot), target, _dim);
+    }
+
+    static constexpr std::size_t PARALLEL_BUILD_CUTOFF = 1 << 15;
+
+    void build(const coord_t *points, std::size_t l, std::size_t r, std::size_t axis, std::size_t threads)
+    {
+        if (l >= r)
+        {
+            return;
+        }
+
+        if (r - l <= _bucket_size)
+        {
+            for (auto slot = l; slot < r; ++slot)
+            {
+                std::copy_n(points + _indices[slot] * dim(), dim(), coords(slot));
+            }
             return;
         }
 
-        std::size_t axis = depth % _dim;
-        auto medianIndex = l + (r - l) / 2;
+        auto medianIndex = l + (r - l - 1) / 2;
 
-        sort(points.begin() + l, points.begin() + r + 1, 
-            [&axis] (const point &a, const point &b) 
+        std::nth_element(_indices.begin() + l, _indices.begin() + medianIndex, _indices.begin() + r,
+            [points, split = _axes[axis], this] (std::size_t a, std::size_t b)
             {
-                return a.coords[axis] < b.coords[axis];
+                return points[a * dim() + split] < points[b * dim() + split];
             }
         );
+        std::copy_n(points + _indices[medianIndex] * dim(), dim(), coords(medianIndex));
 
-        insert(_root, 0, points[medianIndex]);
-
-        if (l != r) 
+        if (threads > 1 && r - l > PARALLEL_BUILD_CUTOFF)
         {
-            build(points, l, medianIndex - 1, depth + 1);
-            build(points, medianIndex + 1, r, depth + 1);
+            std::thread left([&, threads] ()
+            {
+                build(points, l, medianIndex, next_axis(axis), threads / 2);
+            });
+            build(points, medianIndex + 1, r, next_axis(axis), threads - threads / 2);
+            left.join();
+            return;
         }
+
+        build(points, l, medianIndex, next_axis(axis), 1);
+        build(points, medianIndex + 1, r, next_axis(axis), 1);
     }
-    
-    void insert(std::unique_ptr<node> &root, std::size_t depth, const point &request) 
+
+    template<typename Collector>
+    void nearest_neighbor_search(std::size_t l, std::size_t r, const coord_t *target, std::size_t axis, Collector &collector) const
     {
-        if (root == nullptr)
+        if (l >= r)
+        {
+            return;
+        }
+
+        INSTRUMENT_COUNT("kd_tree.nodes_visited", 1);
+        if (r - l <= _bucket_size)
         {
-            root = std::make_unique<node>(request);
+            for (auto slot = l; slot < r; ++slot)
+            {
+                collector.offer(distance(slot, target), slot);
+            }
             return;
         }
 
-        auto axis = depth % _dim;
-        if (request.coords[axis] < root->pt.coords[axis]) 
+        auto slot = l + (r - l - 1) / 2;
+        collector.offer(distance(slot, target), slot);
+
+        double diff = target[_axes[axis]] - coords(slot)[_axes[axis]];
+        if (diff < 0)
         {
-            insert(root->left, depth + 1, request);
+            nearest_neighbor_search(l, slot, target, next_axis(axis), collector);
+            if (diff * diff <= collector.bound())
+            {
+                nearest_neighbor_search(slot + 1, r, target, next_axis(axis), collector);
+            }
         }
-        else 
+        else
         {
-            insert(root->right, depth + 1, request);
+            nearest_neighbor_search(slot + 1, r, target, next_axis(axis), collector);
+            if (diff * diff <= collector.bound())
+            {
+                nearest_neighbor_search(l, slot, target, next_axis(axis), collector);
+            }
         }
     }
 
-    void nearest_neighbor_search(const std::unique_ptr<node> &node, const point &target, std::size_t depth, double &best_dist, point &best_point) const 
+    struct branch
     {
-        if (!node) 
+        double bound;
+        std::size_t l, r, axis;
+
+        bool operator>(const branch &other) const noexcept
         {
-            return;
+            return bound > other.bound;
+        }
+    };
+
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+private:
+    struct nearest_collector
+    {
+        const std::vector<std::size_t> &indices;
+        double best_dist = std::numeric_limits<double>::max();
+        std::size_t best_slot = npos;
+
+        double bound() const noexcept
+        {
+            return best_dist;
+        }
+
+        bool better(double dist, std::size_t slot) const noexcept
+        {
+            return dist < best_dist || (dist == best_dist && (best_slot == npos || indices[slot] < indices[best_slot]));
+        }
+
+        void offer(double dist, std::size_t slot) noexcept
+        {
+            if (better(dist, slot))
+            {
+                best_dist = dist;
+                best_slot = slot;
+            }
+        }
+    };
+
+    struct k_nearest_collector
+    {
+        const std::vector<std::size_t> &indices;
+        std::size_t k;
+        std::vector<neighbor> heap;
+
+        double bound() const noexcept
+        {
+            return heap.size() < k ? std::numeric_limits<double>::max() : heap.front().distance;
+        }
+
+        void offer(double dist, std::size_t slot)
+        {
+            neighbor candidate{dist, indices[slot]};
+            if (heap.size() < k)
+            {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else if (k != 0 && candidate < heap.front())
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    };
+
+    struct radius_collector
+    {
+        const std::vector<std::size_t> &indices;
+        double squared_radius;
+        std::vector<neighbor> found;
+
+        double bound() const noexcept
+        {
+            return std::nextafter(squared_radius, std::numeric_limits<double>::max());
         }
 
-        auto dist = euclidean_distance(node->pt, target);
-        auto axis = depth % _dim;
-    
-        if (dist < best_dist) 
+        void offer(double dist, std::size_t slot)
         {
-            best_dist = dist;
-            best_point = node->pt;
+            if (dist <= squared_radius)
+            {
+                found.push_back({dist, indices[slot]});
+            }
         }
-    
-        double diff = target.coords[axis] - node->pt.coords[axis];
-        const auto &first = (diff < 0) ? node->left : node->right;
-        const auto &second = (diff >= 0) ? node->left : node->right;
-    
-        nearest_neighbor_search(first, target, depth + 1, best_dist, best_point);
-    
-        if (fabs(diff) < best_dist) 
+    };
+
+    static std::vector<neighbor> resolve(std::vector<neighbor> neighbors)
+    {
+        for (auto &item: neighbors)
         {
-            nearest_neighbor_search(second, target, depth + 1, best_dist, best_point);
+            item.distance = std::sqrt(item.distance);
         }
+        std::sort(neighbors.begin(), neighbors.end());
+        return neighbors;
     }
 
 public:
-    explicit kd_tree(std::vector<point> &points, std::size_t d): 
-        _dim(d) 
+    explicit kd_tree() = default;
+
+    explicit kd_tree(const coord_t *points, std::size_t n, std::size_t d, std::size_t threads = std::thread::hardware_concurrency(), std::size_t bucket_size = 0, std::uint32_t seed = 0):
+        _coords(Dim == 0 ? n * d : n), _indices(n), _axes(d), _dim(d), _bucket_size(bucket_size)
     {
-        build(points, 0, points.size() - 1, 0);
+        INSTRUMENT_PHASE("kd_tree.build");
+        std::iota(_axes.begin(), _axes.end(), 0);
+        if (seed != 0)
+        {
+            std::shuffle(_axes.begin(), _axes.end(), std::mt19937(seed));
+        }
+
+        std::iota(_indices.begin(), _indices.end(), 0);
+        build(points, 0, _indices.size(), 0, std::max<std::size_t>(threads, 1));
     }
 
-    point nearest_neighbor(const point &target) const 
+    std::size_t nearest_neighbor(const coord_t *target) const
     {
-        point best_point;
-        auto best_dist = std::numeric_limits<double>::max();
-        nearest_neighbor_search(_root, target, 0, best_dist, best_point);
-        return best_point;
+        nearest_collector collector{_indices};
+        nearest_neighbor_search(0, _indices.size(), target, 0, collector);
+        return collector.best_slot != npos ? _indices[collector.best_slot] : npos;
     }
-};
 
-int main() 
-{
-    std::ios::sync_with_stdio(false); 
-    std::cin.tie(0);
-    
-    std::size_t n, q; 
-    int d;
+    template<typename Filter>
+    neighbor nearest_neighbor_if(const coord_t *target, Filter accept) const
+    {
+        struct filtered_collector
+        {
+            const std::vector<std::size_t> &indices;
+            Filter &accept;
+            double best_dist = std::numeric_limits<double>::max();
+            std::size_t best_slot = npos;
+
+            double bound() const noexcept
+            {
+                return best_dist;
+            }
+
+            void offer(double dist, std::size_t slot)
+            {
+                if ((dist < best_dist || (dist == best_dist && (best_slot == npos || indices[slot] < indices[best_slot]))) && accept(indices[slot]))
+                {
+                    best_dist = dist;
+                    best_slot = slot;
+                }
+            }
+        };
+
+        filtered_collector collector{_indices, accept};
+        nearest_neighbor_search(0, _indices.size(), target, 0, collector);
+        if (collector.best_slot == npos)
+        {
+            return {std::numeric_limits<double>::max(), npos};
+        }
+        return {collector.best_dist, _indices[collector.best_slot]};
+    }
+
+    std::vector<neighbor> k_nearest_neighbors(const coord_t *target, std::size_t k) const
+    {
+        k_nearest_collector collector{_indices, k, {}};
+        collector.heap.reserve(k);
+        nearest_neighbor_search(0, _indices.size(), target, 0, collector);
+        return resolve(std::move(collector.heap));
+    }
 
-    std::cin >> n >> d;
-    std::vector<point> points;
-    points.reserve(n);
+    std::vector<neighbor> radius_neighbors(const coord_t *target, double radius) const
+    {
+        radius_collector collector{_indices, radius * radius, {}};
+        nearest_neighbor_search(0, _indices.size(), target, 0, collector);
+        return resolve(std::move(collector.found));
+    }
 
-    for(size_t i = 0; i < n; ++i) 
+    void save(const std::string &path) const
     {
-        std::vector<ld_t> dimensions;
-        dimensions.resize(d);
-        for(size_t j = 0; j < d; ++j) 
+        std::ofstream ofs(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            throw std::runtime_error("Can't open " + path);
+        }
+
+        tree_header header;
+        std::memcpy(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC));
+        header.size = _indices.size();
+        header.dim = dim();
+        header.bucket_size = _bucket_size;
+
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(_axes.data()), sizeof(std::size_t) * _axes.size());
+        ofs.write(reinterpret_cast<const char *>(_indices.data()), sizeof(std::size_t) * _indices.size());
+        ofs.write(reinterpret_cast<const char *>(_coords.data()), sizeof(point_t) * _coords.size());
+        ofs.close();
+        if (!ofs)
         {
-            std::cin >> dimensions[j];
+            throw std::runtime_error("Write error");
         }
-        points.emplace_back(dimensions, i + 1);
     }
-    kd_tree tree(points, d);
-    std::cin >> q;
 
-    for (size_t i = 0; i < q; ++i) 
+    void load(const std::string &path)
     {
-        std::vector<ld_t> query(d);
-        for (size_t j = 0; j < d; ++j) 
+        INSTRUMENT_PHASE("kd_tree.load");
+        std::ifstream ifs(path, std::ios_base::binary);
+        if (!ifs)
+        {
+            throw std::runtime_error("Can't open " + path);
+        }
+
+        auto header = read_tree_header(ifs);
+        if (Dim != 0 && header.dim != Dim)
+        {
+            throw std::runtime_error("Tree dimension mismatch");
+        }
+
+        std::vector<std::size_t> axes(header.dim), indices(header.size);
+        std::vector<point_t> coords(Dim == 0 ? header.size * header.dim : header.size);
+        ifs.read(reinterpret_cast<char *>(axes.data()), sizeof(std::size_t) * axes.size());
+        ifs.read(reinterpret_cast<char *>(indices.data()), sizeof(std::size_t) * indices.size());
+        ifs.read(reinterpret_cast<char *>(coords.data()), sizeof(point_t) * coords.size());
+        if (!ifs)
         {
-            std::cin >> query[j];
+            throw std::runtime_error("Invalid tree file");
         }
 
-        std::cout << tree.nearest_neighbor(point(query, 0)).index << std::endl;
+        _axes = std::move(axes);
+        _indices = std::move(indices);
+        _coords = std::move(coords);
+        _dim = header.dim;
+        _bucket_size = header.bucket_size;
     }
 
-    return 0;
-}
\ No newline at end of file
+    neighbor approximate_nearest_neighbor(const coord_t *target, double epsilon, std::size_t max_checks) const
+    {
+        nearest_collector collector{_indices};
+        std::size_t checks = 0;
+        auto factor = (1 + epsilon) * (1 + epsilon);
+
+        std::priority_queue<branch, std::vector<branch>, std::greater<branch>> queue;
+        queue.push({0, 0, _indices.size(), 0});
+        while (!queue.empty() && (max_checks == 0 || checks < max_checks))
+        {
+            auto [bound, l, r, axis] = queue.top();
+            queue.pop();
+            if (bound * factor > collector.bound())
+            {
+                break;
+            }
+
+            while (l < r)
+            {
+                if (r - l <= _bucket_size)
+                {
+                    for (auto slot = l; slot < r; ++slot)
+                    {
+                        collector.offer(distance(slot, target), slot);
+                    }
+                    checks += r - l;
+                    break;
+                }
+
+                auto slot = l + (r - l - 1) / 2;
+                collector.offer(distance(slot, target), slot);
+                ++checks;
+
+                double diff = target[_axes[axis]] - coords(slot)[_axes[axis]];
+                auto far_bound = std::max(bound, diff * diff);
+                if (far_bound * factor <= collector.bound())
+                {
+                    if (diff < 0)
+                    {
+                        queue.push({far_bound, slot + 1, r, next_axis(axis)});
+                    }
+                    else
+                    {
+                        queue.push({far_bound, l, slot, next_axis(axis)});
+                    }
+                }
+
+                if (diff < 0)
+                {
+                    r = slot;
+                }
+                else
+                {
+                    l = slot + 1;
+                }
+                axis = next_axis(axis);
+            }
+        }
+
+        INSTRUMENT_COUNT("kd_tree.approximate_checks", checks);
+        if (collector.best_slot == npos)
+        {
+            return {std::numeric_limits<double>::max(), npos};
+        }
+        return {std::sqrt(collector.best_dist), _indices[collector.best_slot]};
+    }
+};
+
+template<std::size_t Dim = 0>
+class kd_forest
+{
+    std::vector<kd_tree<Dim>> _trees;
+
+public:
+    explicit kd_forest(const coord_t *points, std::size_t n, std::size_t d, std::size_t trees, std::size_t threads, std::size_t bucket_size)
+    {
+        _trees.reserve(trees);
+        for (std::size_t i = 0; i < trees; ++i)
+        {
+            _trees.emplace_back(points, n, d, threads, bucket_size, i + 1);
+        }
+    }
+
+    neighbor approximate_nearest_neighbor(const coord_t *target, double epsilon, std::size_t max_checks) const
+    {
+        neighbor best{std::numeric_limits<double>::max(), kd_tree<Dim>::npos};
+        auto checks = max_checks != 0 ? std::max<std::size_t>(1, max_checks / _trees.size()) : 0;
+        for (const auto &tree: _trees)
+        {
+            best = std::min(best, tree.approximate_nearest_neighbor(target, epsilon, checks));
+        }
+        return best;
+    }
+};
+
+template<std::size_t Dim = 0>
+class dynamic_kd_tree
+{
+    struct level
+    {
+        std::vector<coord_t> points;
+        std::vector<std::size_t> ids;
+        std::unordered_set<std::size_t> erased;
+        std::unique_ptr<kd_tree<Dim>> tree;
+    };
+
+    std::vector<level> _levels;
+    std::unordered_map<std::size_t, std::size_t> _level_of;
+    std::size_t _dim = 0;
+    std::size_t _bucket_size = 0;
+
+    void rebuild(std::size_t index)
+    {
+        auto &current = _levels[index];
+        std::vector<std::size_t> order(current.ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&current](std::size_t a, std::size_t b)
+        {
+            return current.ids[a] < current.ids[b];
+        });
+
+        level sorted;
+        sorted.points.reserve(current.points.size());
+        sorted.ids.reserve(current.ids.size());
+        for (auto position: order)
+        {
+            sorted.points.insert(sorted.points.end(), current.points.begin() + position * _dim, current.points.begin() + (position + 1) * _dim);
+            sorted.ids.push_back(current.ids[position]);
+        }
+        current.points = std::move(sorted.points);
+        current.ids = std::move(sorted.ids);
+
+        for (auto id: current.ids)
+        {
+            _level_of[id] = index;
+        }
+        current.tree = current.ids.empty() ? nullptr : std::make_unique<kd_tree<Dim>>(current.points.data(), current.ids.size(), _dim, 1, _bucket_size);
+    }
+
+    void take_live(level &from, level &to) const
+    {
+        for (std::size_t i = 0; i < from.ids.size(); ++i)
+        {
+            if (from.erased.count(from.ids[i]) == 0)
+            {
+                to.points.insert(to.points.end(), from.points.begin() + i * _dim, from.points.begin() + (i + 1) * _dim);
+                to.ids.push_back(from.ids[i]);
+            }
+        }
+        from = level();
+    }
+
+public:
+    static constexpr std::size_t npos = kd_tree<Dim>::npos;
+
+    explicit dynamic_kd_tree(std::size_t d, std::size_t bucket_size = 0):
+        _dim(d), _bucket_size(bucket_size)
+    {
+
+    }
+
+    explicit dynamic_kd_tree(const coord_t *points, std::size_t n, std::size_t d, std::size_t bucket_size = 0):
+        _dim(d), _bucket_size(bucket_size)
+    {
+        if (n == 0)
+        {
+            return;
+        }
+
+        std::size_t index = 0;
+        while ((std::size_t(1) << index) < n)
+        {
+            ++index;
+        }
+
+        _levels.resize(index + 1);
+        _levels[index].points.assign(points, points + n * d);
+        _levels[index].ids.resize(n);
+        std::iota(_levels[index].ids.begin(), _levels[index].ids.end(), 0);
+        rebuild(index);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _level_of.size();
+    }
+
+    void insert(const coord_t *point, std::size_t id)
+    {
+        if (_level_of.count(id) != 0)
+        {
+            throw std::logic_error("Exist");
+        }
+
+        level carry;
+        carry.points.assign(point, point + _dim);
+        carry.ids.push_back(id);
+
+        std::size_t index = 0;
+        for (; index < _levels.size() && !_levels[index].ids.empty(); ++index)
+        {
+            take_live(_levels[index], carry);
+        }
+
+        if (index == _levels.size())
+        {
+            _levels.emplace_back();
+        }
+        _levels[index] = std::move(carry);
+        rebuild(index);
+    }
+
+    void erase(std::size_t id)
+    {
+        auto it = _level_of.find(id);
+        if (it == _level_of.end())
+        {
+            throw std::logic_error("NoSuchPoint");
+        }
+
+        auto index = it->second;
+        _level_of.erase(it);
+
+        auto &current = _levels[index];
+        current.erased.insert(id);
+        if (current.erased.size() * 2 > current.ids.size())
+        {
+            level compacted;
+            take_live(current, compacted);
+            current = std::move(compacted);
+            rebuild(index);
+        }
+    }
+
+    std::size_t nearest_neighbor(const coord_t *target) const
+    {
+        neighbor best{std::numeric_limits<double>::max(), npos};
+        for (const auto &current: _levels)
+        {
+            if (current.tree == nullptr)
+            {
+                continue;
+            }
+
+            auto found = current.tree->nearest_neighbor_if(target, [&current](std::size_t position)
+            {
+                return current.erased.empty() || current.erased.count(current.ids[position]) == 0;
+            });
+            if (found.index != npos && neighbor{found.distance, current.ids[found.index]} < best)
+            {
+                best = {found.distance, current.ids[found.index]};
+            }
+        }
+        return best.index;
+    }
+};
+
+struct options
+{
+    std::size_t knn = 0;
+    double radius = -1;
+    std::size_t bucket_size = 32;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool curve = false;
+    double epsilon = 0;
+    std::size_t checks = 0;
+    std::size_t trees = 0;
+    bool recall = false;
+    bool dynamic = false;
+    bool stats = false;
+    std::string points_path, convert_path, save_tree_path, load_tree_path;
+    bool float32 = false;
+
+    bool approximate() const noexcept
+    {
+        return epsilon > 0 || checks != 0 || trees != 0;
+    }
+};
+
+constexpr std::size_t QUERY_CHUNK = 256;
+
+options parse_options(int argc, char *argv[])
+{
+    options result;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--curve" || argument == "--recall" || argument == "--dynamic" || argument == "--stats" || argument == "--float32")
+        {
+            (argument == "--curve" ? result.curve : argument == "--recall" ? result.recall : argument == "--dynamic" ? result.dynamic :
+             argument == "--stats" ? result.stats : result.float32) = true;
+            continue;
+        }
+
+        if (i + 1 == argc)
+        {
+            throw std::invalid_argument("Usage: cp [--knn <k> | --radius <r>] [--bucket <size>] [--threads <n>] [--curve] [--epsilon <e>] [--checks <n>] [--trees <t>] [--recall] [--dynamic [--stats]] "
+                                        "[--points <file> | --convert <file> [--float32]] [--save-tree <file> | --load-tree <file>]");
+        }
+
+        if (argument == "--knn")
+        {
+            result.knn = std::stoul(argv[++i]);
+        }
+        else if (argument == "--radius")
+        {
+            result.radius = std::stod(argv[++i]);
+        }
+        else if (argument == "--bucket")
+        {
+            result.bucket_size = std::stoul(argv[++i]);
+        }
+        else if (argument == "--threads")
+        {
+            result.threads = std::stoul(argv[++i]);
+            if (result.threads == 0)
+            {
+                result.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else if (argument == "--epsilon")
+        {
+            result.epsilon = std::stod(argv[++i]);
+        }
+        else if (argument == "--checks")
+        {
+            result.checks = std::stoul(argv[++i]);
+        }
+        else if (argument == "--trees")
+        {
+            result.trees = std::stoul(argv[++i]);
+        }
+        else if (argument == "--points")
+        {
+            result.points_path = argv[++i];
+        }
+        else if (argument == "--convert")
+        {
+            result.convert_path = argv[++i];
+        }
+        else if (argument == "--save-tree")
+        {
+            result.save_tree_path = argv[++i];
+        }
+        else if (argument == "--load-tree")
+        {
+            result.load_tree_path = argv[++i];
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option " + argument);
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::size_t> morton_order(const std::vector<coord_t> &queries, std::size_t d)
+{
+    std::size_t q = queries.size() / d;
+    std::size_t dims = std::min<std::size_t>(d, 64);
+    std::size_t bits = std::min<std::size_t>(64 / dims, 21);
+
+    std::vector<coord_t> low(dims, std::numeric_limits<coord_t>::max()), high(dims, std::numeric_limits<coord_t>::lowest());
+    for (std::size_t i = 0; i < q; ++i)
+    {
+        for (std::size_t j = 0; j < dims; ++j)
+        {
+            low[j] = std::min(low[j], queries[i * d + j]);
+            high[j] = std::max(high[j], queries[i * d + j]);
+        }
+    }
+
+    std::vector<std::uint64_t> codes(q, 0);
+    for (std::size_t i = 0; i < q; ++i)
+    {
+        for (std::size_t j = 0; j < dims; ++j)
+        {
+            auto range = high[j] - low[j];
+            auto cell = static_cast<std::uint64_t>(range > 0 ? (queries[i * d + j] - low[j]) / range * ((1ull << bits) - 1) : 0);
+            for (std::size_t bit = 0; bit < bits; ++bit)
+            {
+                codes[i] |= ((cell >> bit) & 1) << (bit * dims + j);
+            }
+        }
+    }
+
+    std::vector<std::size_t> order(q);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&codes](std::size_t a, std::size_t b)
+    {
+        return codes[a] < codes[b];
+    });
+    return order;
+}
+
+template<typename Query>
+void for_each_query(std::size_t q, const std::vector<std::size_t> &order, std::size_t threads, Query query)
+{
+    INSTRUMENT_PHASE("cp.queries");
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]()
+    {
+        for (auto begin = next.fetch_add(QUERY_CHUNK); begin < q; begin = next.fetch_add(QUERY_CHUNK))
+        {
+            INSTRUMENT_COUNT("cp.queries", std::min(q, begin + QUERY_CHUNK) - begin);
+            for (auto i = begin; i < std::min(q, begin + QUERY_CHUNK); ++i)
+            {
+                query(order.empty() ? i : order[i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threads; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: pool)
+    {
+        thread.join();
+    }
+}
+
+template<std::size_t Dim>
+void run_approximate(const point_set &points, const std::vector<coord_t> &queries, std::size_t d, const std::vector<std::size_t> &order, const options &opts)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::size_t q = queries.size() / d;
+    if (!opts.load_tree_path.empty())
+    {
+        throw std::invalid_argument("Approximate search needs the points");
+    }
+
+    kd_forest<Dim> forest(points.data(), points.size(), d, std::max<std::size_t>(opts.trees, 1), opts.threads, opts.bucket_size);
+
+    std::vector<neighbor> approximate(q);
+    auto start = clock::now();
+    for_each_query(q, order, opts.threads, [&](std::size_t i)
+    {
+        approximate[i] = forest.approximate_nearest_neighbor(queries.data() + i * d, opts.epsilon, opts.checks);
+    });
+    std::chrono::duration<double> approximate_time = clock::now() - start;
+
+    if (opts.recall)
+    {
+        kd_tree<Dim> tree(points.data(), points.size(), d, opts.threads, opts.bucket_size);
+        std::vector<neighbor> exact(q);
+        start = clock::now();
+        for_each_query(q, order, opts.threads, [&](std::size_t i)
+        {
+            auto index = tree.nearest_neighbor(queries.data() + i * d);
+            exact[i] = {std::sqrt(squared_distance<Dim>(points.data() + index * d, queries.data() + i * d, d)), index};
+        });
+        std::chrono::duration<double> exact_time = clock::now() - start;
+
+        std::size_t hits = 0;
+        for (std::size_t i = 0; i < q; ++i)
+        {
+            hits += approximate[i].distance <= exact[i].distance;
+        }
+        std::cerr << "recall: " << (q != 0 ? static_cast<double>(hits) / q : 1.0)
+                  << ", approximate: " << approximate_time.count() << " s"
+                  << ", exact: " << exact_time.count() << " s" << std::endl;
+    }
+
+    fast_io::writer output;
+    for (const auto &item: approximate)
+    {
+        output.write(item.index + 1);
+        output.write('\n');
+    }
+}
+
+template<std::size_t Dim>
+void run(const point_set &points, const std::vector<coord_t> &queries, std::size_t d, const options &opts)
+{
+    std::size_t q = queries.size() / d;
+    std::vector<std::size_t> order;
+    if (opts.curve)
+    {
+        order = morton_order(queries, d);
+    }
+
+    if (opts.approximate())
+    {
+        run_approximate<Dim>(points, queries, d, order, opts);
+        return;
+    }
+
+    kd_tree<Dim> tree;
+    if (!opts.load_tree_path.empty())
+    {
+        tree.load(opts.load_tree_path);
+    }
+    else
+    {
+        tree = kd_tree<Dim>(points.data(), points.size(), d, opts.threads, opts.bucket_size);
+    }
+
+    if (!opts.save_tree_path.empty())
+    {
+        tree.save(opts.save_tree_path);
+    }
+
+    fast_io::writer output;
+    if (opts.knn == 0 && opts.radius < 0)
+    {
+        std::vector<std::size_t> nearest(q);
+        for_each_query(q, order, opts.threads, [&](std::size_t i)
+        {
+            nearest[i] = tree.nearest_neighbor(queries.data() + i * d);
+        });
+
+        for (auto index: nearest)
+        {
+            output.write(index + 1);
+            output.write('\n');
+        }
+        return;
+    }
+
+    std::vector<std::vector<neighbor>> neighbors(q);
+    for_each_query(q, order, opts.threads, [&](std::size_t i)
+    {
+        neighbors[i] = opts.knn != 0 ? tree.k_nearest_neighbors(queries.data() + i * d, opts.knn) : tree.radius_neighbors(queries.data() + i * d, opts.radius);
+    });
+
+    for (const auto &list: neighbors)
+    {
+        for (std::size_t i = 0; i < list.size(); ++i)
+        {
+            output.write(list[i].index + 1);
+            if (i + 1 != list.size())
+            {
+                output.write(' ');
+            }
+        }
+        output.write('\n');
+    }
+}
+
+template<std::size_t Dim>
+void run_dynamic(const point_set &points, std::size_t d, fast_io::reader &input, const options &opts)
+{
+    using clock = std::chrono::steady_clock;
+
+    dynamic_kd_tree<Dim> tree(points.data(), points.size(), d, opts.bucket_size);
+    std::size_t next_id = points.size();
+
+    std::size_t q = 0;
+    input.read(q);
+
+    fast_io::writer output;
+    std::vector<coord_t> point(d);
+    std::size_t updates = 0;
+    std::chrono::duration<double> update_time(0), query_time(0);
+    for (std::size_t i = 0; i < q; ++i)
+    {
+        char command = 0;
+        input.read(command);
+        if (command == '-')
+        {
+            std::size_t id = 0;
+            input.read(id);
+            auto start = opts.stats ? clock::now() : clock::time_point();
+            try
+            {
+                tree.erase(id - 1);
+            }
+            catch (const std::logic_error &exception)
+            {
+                output.write(std::string(exception.what()) + '\n');
+            }
+            if (opts.stats)
+            {
+                update_time += clock::now() - start;
+                ++updates;
+            }
+            continue;
+        }
+
+        for (auto &coord: point)
+        {
+            input.read(coord);
+        }
+
+        auto start = opts.stats ? clock::now() : clock::time_point();
+        if (command == '+')
+        {
+            tree.insert(point.data(), next_id++);
+            if (opts.stats)
+            {
+                update_time += clock::now() - start;
+                ++updates;
+            }
+            continue;
+        }
+
+        auto index = tree.nearest_neighbor(point.data());
+        if (opts.stats)
+        {
+            query_time += clock::now() - start;
+        }
+        if (index == tree.npos)
+        {
+            output.write(std::string("-1\n"));
+            continue;
+        }
+        output.write(index + 1);
+        output.write('\n');
+    }
+
+    if (opts.stats)
+    {
+        auto queries = q - updates;
+        std::cerr << "updates: " << update_time.count() << " s, " << (updates != 0 ? update_time.count() / updates * 1e6 : 0.0) << " us/update"
+                  << ", queries: " << query_time.count() << " s, " << (queries != 0 ? query_time.count() / queries * 1e6 : 0.0) << " us/query" << std::endl;
+    }
+}
+
+template<typename Function>
+void dispatch(std::size_t d, Function function)
+{
+    switch (d)
+    {
+    case 2:
+        function(std::integral_constant<std::size_t, 2>());
+        break;
+    case 3:
+        function(std::integral_constant<std::size_t, 3>());
+        break;
+    case 8:
+        function(std::integral_constant<std::size_t, 8>());
+        break;
+    case 128:
+        function(std::integral_constant<std::size_t, 128>());
+        break;
+    default:
+        function(std::integral_constant<std::size_t, 0>());
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        auto opts = parse_options(argc, argv);
+        fast_io::reader input;
+
+        std::size_t n = 0, q = 0, d = 0;
+        point_set points;
+        if (!opts.points_path.empty())
+        {
+            points.load(opts.points_path);
+            d = points.dim();
+        }
+        else if (!opts.load_tree_path.empty())
+        {
+            d = tree_file_dimension(opts.load_tree_path);
+        }
+        else
+        {
+            INSTRUMENT_PHASE("cp.read_points");
+            input.read(n);
+            input.read(d);
+            std::vector<coord_t> coords(n * d);
+            for (auto &coord: coords)
+            {
+                input.read(coord);
+            }
+            points.assign(std::move(coords), d);
+        }
+
+        if (!opts.convert_path.empty())
+        {
+            points.save(opts.convert_path, opts.float32 ? point_set::FLOAT32 : point_set::FLOAT64);
+            return 0;
+        }
+
+        if (opts.dynamic)
+        {
+            if (!opts.load_tree_path.empty())
+            {
+                throw std::invalid_argument("Dynamic mode needs the points");
+            }
+
+            dispatch(d, [&](auto dim)
+            {
+                run_dynamic<decltype(dim)::value>(points, d, input, opts);
+            });
+            return 0;
+        }
+
+        std::vector<coord_t> queries;
+        {
+            INSTRUMENT_PHASE("cp.read_queries");
+            input.read(q);
+            queries.resize(q * d);
+            for (auto &coord: queries)
+            {
+                input.read(coord);
+            }
+        }
+
+        dispatch(d, [&](auto dim)
+        {
+            run<decltype(dim)::value>(points, queries, d, opts);
+        });
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "ERROR: " << exception.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,6 +1,10 @@
 #include <cstdlib>
 #include <stdexcept>
 #include <cstring>
+#include <string>
+
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
 
 namespace lab {
     template<typename T>
@@ -80,6 +84,7 @@ private:
 };
 
 void counting_sort(lab::vector<lab::pair> &pairs) {
+    INSTRUMENT_PHASE("lab1.sort");
     int count[lab::MAX_KEY] = {0};
 
     for (int i = 0; i < pairs.size(); ++i) {
@@ -108,42 +113,47 @@ void counting_sort(lab::vector<lab::pair> &pairs) {
 
 int main() {
     lab::vector<lab::pair> pairs;
-    char line[256];
+    fast_io::reader input;
+    std::string line;
 
-    while (fgets(line, sizeof(line), stdin)) {
-        if (strlen(line) == 0 || line[0] == '\n') continue;
+    {
+        INSTRUMENT_PHASE("lab1.read");
+        while (input.read_line(line)) {
+            if (line.empty()) continue;
 
-        char* tab_pos = strchr(line, '\t');
-        if (tab_pos != nullptr) {
-            *tab_pos = '\0';
+            auto tab_pos = line.find('\t');
+            if (tab_pos != std::string::npos) {
+                line[tab_pos] = '\0';
 
-            int key = atoi(line);
+                int key = atoi(line.c_str());
 
-            char* value = tab_pos + 1;
-            std::size_t value_len = strlen(value);
+                const char* value = line.c_str() + tab_pos + 1;
+                std::size_t value_len = strlen(value);
 
-            if (value[value_len - 1] == '\n') {
-                value[value_len - 1] = '\0';
-                value_len--;
-            }
+                lab::pair pair;
+                pair.key = key;
 
-            lab::pair pair;
-            pair.key = key;
+                strncpy(pair.value, value, lab::MAX_STRING_LENGTH);
+                pair.value[lab::MAX_STRING_LENGTH] = '\0';
+                for (int i = value_len; i < lab::MAX_STRING_LENGTH; ++i) {
+                    pair.value[i] = '\0';
+                }
 
-            strncpy(pair.value, value, lab::MAX_STRING_LENGTH);
-            pair.value[lab::MAX_STRING_LENGTH] = '\0';
-            for (int i = value_len; i < lab::MAX_STRING_LENGTH; ++i) {
-                pair.value[i] = '\0';
+                pairs.push_back(pair);
             }
-
-            pairs.push_back(pair);
         }
     }
 
     counting_sort(pairs);
+
+    INSTRUMENT_PHASE("lab1.write");
+    fast_io::writer output;
     for (std::size_t i = 0; i < pairs.size(); i++)
     {
-        printf("%d\t%s\n", pairs[i].key, pairs[i].value);
+        output.write(pairs[i].key);
+        output.write('\t');
+        output.write(std::string_view(pairs[i].value));
+        output.write('\n');
     }
 
     return 0;
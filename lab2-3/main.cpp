@@ -1,11 +1,13 @@
 #include <algorithm>
-#include <iostream>
 #include <stdexcept>
 #include <string>
 #include <fstream>
 #include <utility>
 #include <cstdint>
 
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
+
 #ifdef LAB3
 #include "dmalloc.h"
 #endif
@@ -66,11 +68,13 @@ public:
 
     void insert(const Key &key, const Value &value)
     {
+        INSTRUMENT_COUNT("avl.inserts", 1);
         _root = insert(_root, key, value);
     }
 
     void remove(const Key &key)
     {
+        INSTRUMENT_COUNT("avl.removes", 1);
         _root = remove(_root, key);
     }
 
@@ -153,6 +157,7 @@ private:
 
     node *rotate_right(node *node) noexcept
     {
+        INSTRUMENT_COUNT("avl.rotations", 1);
         auto tmp1 = node->left;
         auto tmp2 = tmp1->right;
 
@@ -167,6 +172,7 @@ private:
 
     node *rotate_left(node *node) noexcept
     {
+        INSTRUMENT_COUNT("avl.rotations", 1);
         auto tmp1 = node->right;
         auto tmp2 = tmp1->left;
 
@@ -361,32 +367,34 @@ private:
 
 int main()
 {
-#ifndef LAB3
-    std::ios::sync_with_stdio(false);
-    std::cin.tie(nullptr);
-#endif
+    fast_io::reader input;
+    fast_io::writer output;
 
     AVL_tree<std::string, std::uint64_t> tree;
 
     std::string command;
     std::string word;
 
-    while (std::cin >> command)
+    INSTRUMENT_PHASE("lab2-3.commands");
+    while (input.read(command))
     {
         if (command == "!")
         {
             std::string path;
-            std::cin >> word >> path;
+            input.read(word);
+            input.read(path);
             if (word == "Save")
             {
                 try
                 {
                     tree.save(path);
-                    std::cout << "OK" << std::endl;
+                    output.write("OK\n");
                 }
                 catch (const std::exception &exception)
                 {
-                    std::cout << "ERROR:" << exception.what() << std::endl;
+                    output.write("ERROR:");
+                    output.write(exception.what());
+                    output.write('\n');
                 }
             }
             else if (word == "Load")
@@ -394,43 +402,48 @@ int main()
                 try
                 {
                     tree.load(path);
-                    std::cout << "OK" << std::endl;
+                    output.write("OK\n");
                 }
                 catch (const std::exception &exception)
                 {
-                    std::cout << "ERROR:" << exception.what() << std::endl;
+                    output.write("ERROR:");
+                    output.write(exception.what());
+                    output.write('\n');
                 }
             }
         }
         else if (command == "-")
         {
-            std::cin >> word;
+            input.read(word);
             transform(word.begin(), word.end(), word.begin(), ::tolower);
 
             try
             {
                 tree.remove(word);
-                std::cout << "OK" << std::endl;
+                output.write("OK\n");
             }
             catch (const std::logic_error &exception)
             {
-                std::cout << exception.what() << std::endl;
+                output.write(exception.what());
+                output.write('\n');
             }
         }
         else if (command == "+")
         {
-            std::uint64_t value;
-            std::cin >> word >> value;
+            std::uint64_t value = 0;
+            input.read(word);
+            input.read(value);
             transform(word.begin(), word.end(), word.begin(), ::tolower);
 
             try
             {
                 tree.insert(word, value);
-                std::cout << "OK" << std::endl;
+                output.write("OK\n");
             }
             catch (const std::logic_error &exception)
             {
-                std::cout << exception.what() << std::endl;
+                output.write(exception.what());
+                output.write('\n');
             }
         }
         else
@@ -443,10 +456,13 @@ int main()
             }
             catch (const std::logic_error &exception)
             {
-                std::cout << exception.what() << std::endl;
+                output.write(exception.what());
+                output.write('\n');
                 continue;
             }
-            std::cout << "OK: " << result << std::endl;
+            output.write("OK: ");
+            output.write(result);
+            output.write('\n');
         }
     }
 
@@ -1,6 +1,10 @@
-#include <iostream>
+#include <cctype>
+#include <string>
 #include <vector>
 
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
+
 struct token_position
 {
     int line_number;
@@ -50,7 +54,7 @@ std::vector<int> compute_prefix_function(const std::vector<std::string> &pattern
     return result;
 }
 
-void process_line(const std::string &line, int line_number, const std::vector<std::string> &pattern_tokens, const std::vector<int> &prefix_function, int &matched_tokens_count, std::vector<token_position> &position_buffer, int &buffer_index, int pattern_length)
+void process_line(const std::string &line, int line_number, const std::vector<std::string> &pattern_tokens, const std::vector<int> &prefix_function, int &matched_tokens_count, std::vector<token_position> &position_buffer, int &buffer_index, int pattern_length, fast_io::writer &output)
 {
     std::string word;
     int index_in_line = 0;
@@ -65,9 +69,11 @@ void process_line(const std::string &line, int line_number, const std::vector<st
             index_in_line++;
             buffer_index = (buffer_index + 1) % pattern_length;
             position_buffer[buffer_index] = {line_number, index_in_line};
+            INSTRUMENT_COUNT("kmp.tokens", 1);
 
             while (matched_tokens_count > 0 && pattern_tokens[matched_tokens_count] != word)
             {
+                INSTRUMENT_COUNT("kmp.fallbacks", 1);
                 matched_tokens_count = prefix_function[matched_tokens_count - 1];
             }
 
@@ -82,7 +88,11 @@ void process_line(const std::string &line, int line_number, const std::vector<st
 
             if (matched_tokens_count == pattern_length)
             {
-                std::cout << position_buffer[(buffer_index + 1) % pattern_length].line_number << ", " << position_buffer[(buffer_index + 1) % pattern_length].index_in_line << "\n";
+                INSTRUMENT_COUNT("kmp.matches", 1);
+                output.write(position_buffer[(buffer_index + 1) % pattern_length].line_number);
+                output.write(", ");
+                output.write(position_buffer[(buffer_index + 1) % pattern_length].index_in_line);
+                output.write('\n');
                 matched_tokens_count = prefix_function[matched_tokens_count - 1];
             }
             word.clear();
@@ -92,11 +102,11 @@ void process_line(const std::string &line, int line_number, const std::vector<st
 
 int main()
 {
-    std::ios::sync_with_stdio(false);
-    std::cin.tie(nullptr);
+    fast_io::reader input;
+    fast_io::writer output;
 
     std::string pattern;
-    std::getline(std::cin, pattern);
+    input.read_line(pattern);
 
     auto pattern_tokens = tokenize(pattern);
     int pattern_tokens_size = pattern_tokens.size();
@@ -108,10 +118,11 @@ int main()
     std::string line;
     int line_number = 0;
     int matched_tokens_count = 0;
-    while (std::getline(std::cin, line))
+    INSTRUMENT_PHASE("lab4.search");
+    while (input.read_line(line))
     {
         line_number++;
-        process_line(line, line_number, pattern_tokens, prefix_function, matched_tokens_count, position_buffer, buffer_index, pattern_tokens_size);
+        process_line(line, line_number, pattern_tokens, prefix_function, matched_tokens_count, position_buffer, buffer_index, pattern_tokens_size, output);
     }
 
     return 0;
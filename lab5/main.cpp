@@ -1,22 +1,83 @@
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <queue>
+#include <stdexcept>
 #include <unordered_map>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
+
 class suffix_tree
 {
 private:
     struct node
     {
         int left, right, appear;
-        std::unordered_map<char, int> children;
+        std::unordered_map<std::int32_t, int> children;
 
         node(int left = -1, int right = -1, int appear = -1): left(left), right(right), appear(appear) {}
     };
 
+    struct packed_node
+    {
+        std::int32_t left, right, appear, edges_begin, edges_end;
+        std::int32_t leaves, first_appear;
+    };
+
+    struct packed_edge
+    {
+        std::int32_t child;
+        std::int32_t symbol;
+    };
+
+    struct index_header
+    {
+        char magic[8];
+        std::uint64_t text_size, nodes_count, edges_count, documents_count;
+    };
+
+    static constexpr char INDEX_MAGIC[8] = {'S', 'U', 'F', 'T', 'R', 'E', 'E', '3'};
+    static constexpr char TERMINATOR = '$';
+
     std::vector<node> _nodes;
     std::string _text;
+    std::vector<std::int32_t> _starts;
+
+    std::vector<packed_node> _packed_nodes;
+    std::vector<packed_edge> _packed_edges;
+
+    const packed_node *_view_nodes = nullptr;
+    const packed_edge *_view_edges = nullptr;
+    const char *_view_text = nullptr;
+    const std::int32_t *_view_starts = nullptr;
+    std::size_t _view_nodes_count = 0, _view_edges_count = 0, _view_text_size = 0, _view_documents_count = 0;
+
+    void *_mapping = nullptr;
+    std::size_t _mapping_size = 0;
+
+    std::int32_t symbol(int position) const noexcept
+    {
+        return _text[position] == TERMINATOR ? -1 - position : static_cast<unsigned char>(_text[position]);
+    }
+
+    bool equal(int first, int second) const noexcept
+    {
+        return _text[first] == _text[second] && _text[first] != TERMINATOR;
+    }
 
     void insert(int left, int right)
     {
@@ -26,14 +87,14 @@ private:
         {
             if (current == 0)
             {
-                if (_nodes[current].children.find(_text[left]) != _nodes[current].children.cend())
+                if (_nodes[current].children.find(symbol(left)) != _nodes[current].children.cend())
                 {
-                    current = _nodes[current].children[_text[left]];
+                    current = _nodes[current].children[symbol(left)];
                 }
                 if (current == 0)
                 {
                     _nodes.emplace_back(left, right, old_left);
-                    _nodes[current].children[_text[left]] = _nodes.size() - 1;
+                    _nodes[current].children[symbol(left)] = _nodes.size() - 1;
                     break; 
                 }
             }
@@ -44,7 +105,7 @@ private:
 
             for (int i = start; i <= finish && left + i - start <= right; ++i)
             {
-                if (_text[i] == _text[left + i - start])
+                if (equal(i, left + i - start))
                 {
                     continue;
                 }
@@ -53,7 +114,7 @@ private:
                 int old_appear = _nodes[current].appear;
                 _nodes[current].appear = -1;
 
-                if (_text[finish] == '$')
+                if (_text[finish] == TERMINATOR)
                 {
                     _nodes.emplace_back(i, finish, old_appear);
                 }
@@ -64,10 +125,11 @@ private:
 
                 _nodes.back().children = _nodes[current].children;
                 _nodes[current].children.clear();
-                _nodes[current].children[_text[i]] = _nodes.size() - 1;
+                _nodes[current].children[symbol(i)] = _nodes.size() - 1;
                 
                 _nodes.emplace_back(left + i - start, right, old_left);
-                _nodes[current].children[_text[left + i - start]] = _nodes.size() - 1;
+                _nodes[current].children[symbol(left + i - start)] = _nodes.size() - 1;
+                INSTRUMENT_COUNT("suffix_tree.edge_splits", 1);
                 cut = true;
                 break;
             }
@@ -78,127 +140,687 @@ private:
             }
 
             int new_left = left + finish - start + 1;
-            if (_nodes[current].children.find(_text[new_left]) == _nodes[current].children.cend())
+            if (_nodes[current].children.find(symbol(new_left)) == _nodes[current].children.cend())
             {
                 _nodes.emplace_back(new_left, right, old_left);
-                _nodes[current].children[_text[new_left]] = _nodes.size() - 1;
+                _nodes[current].children[symbol(new_left)] = _nodes.size() - 1;
                 break;
             }
 
-            current = _nodes[current].children[_text[new_left]];
+            current = _nodes[current].children[symbol(new_left)];
             left = new_left;
         }
     }
 
-    void dfs(std::vector<int> &appearances, int current)
+    void pack()
     {
-        if (_nodes[current].children.empty())
+        _packed_nodes.resize(_nodes.size());
+        _packed_edges.clear();
+        _packed_edges.reserve(_nodes.size());
+        for (std::size_t i = 0; i < _nodes.size(); ++i)
         {
-            appearances.push_back(_nodes[current].appear);
-            return;
+            auto &packed = _packed_nodes[i];
+            packed.left = _nodes[i].left;
+            packed.right = _nodes[i].right;
+            packed.appear = _nodes[i].appear;
+            packed.edges_begin = _packed_edges.size();
+            for (const auto &[symbol, child]: _nodes[i].children)
+            {
+                _packed_edges.push_back({child, symbol});
+            }
+            packed.edges_end = _packed_edges.size();
+            std::sort(_packed_edges.begin() + packed.edges_begin, _packed_edges.end(), [](const packed_edge &a, const packed_edge &b)
+            {
+                return a.symbol < b.symbol;
+            });
         }
 
-        for (const auto &[symbol, child]: _nodes[current].children)
+        _nodes.clear();
+        _nodes.shrink_to_fit();
+        annotate();
+        view(_packed_nodes.data(), _packed_nodes.size(), _packed_edges.data(), _packed_edges.size(), _text.data(), _text.size(), _starts.data(), _starts.size());
+    }
+
+    void annotate()
+    {
+        std::vector<std::pair<int, int>> stack;
+        stack.reserve(_text.size() + 1);
+
+        auto enter = [&](int current)
+        {
+            auto &node = _packed_nodes[current];
+            if (node.edges_begin == node.edges_end)
+            {
+                node.leaves = 1;
+                node.first_appear = node.appear;
+                return;
+            }
+
+            node.leaves = 0;
+            node.first_appear = INT32_MAX;
+            stack.emplace_back(current, node.edges_begin);
+        };
+
+        auto fold = [&](int parent, int child)
+        {
+            _packed_nodes[parent].leaves += _packed_nodes[child].leaves;
+            _packed_nodes[parent].first_appear = std::min(_packed_nodes[parent].first_appear, _packed_nodes[child].first_appear);
+        };
+
+        enter(0);
+        while (!stack.empty())
         {
-            dfs(appearances, child);
+            auto [current, edge] = stack.back();
+            if (edge == _packed_nodes[current].edges_end)
+            {
+                stack.pop_back();
+                if (!stack.empty())
+                {
+                    fold(stack.back().first, current);
+                }
+                continue;
+            }
+
+            stack.back().second++;
+            auto child = _packed_edges[edge].child;
+            enter(child);
+            if (_packed_nodes[child].edges_begin == _packed_nodes[child].edges_end)
+            {
+                fold(current, child);
+            }
         }
     }
 
-public:
+    void unpack()
+    {
+        std::string text(_view_text, _view_text_size);
+        std::vector<std::int32_t> starts(_view_starts, _view_starts + _view_documents_count);
+        std::vector<node> nodes;
+        nodes.reserve(_view_nodes_count);
+        for (std::size_t i = 0; i < _view_nodes_count; ++i)
+        {
+            const auto &packed = _view_nodes[i];
+            nodes.emplace_back(packed.left, packed.right, packed.appear);
+            for (int j = packed.edges_begin; j < packed.edges_end; ++j)
+            {
+                nodes.back().children[_view_edges[j].symbol] = _view_edges[j].child;
+            }
+        }
+
+        unmap();
+        _packed_nodes.clear();
+        _packed_edges.clear();
+        _nodes = std::move(nodes);
+        _text = std::move(text);
+        _starts = std::move(starts);
+    }
+
+    void view(const packed_node *nodes, std::size_t nodes_count, const packed_edge *edges, std::size_t edges_count,
+              const char *text, std::size_t text_size, const std::int32_t *starts, std::size_t documents_count) noexcept
+    {
+        _view_nodes = nodes;
+        _view_nodes_count = nodes_count;
+        _view_edges = edges;
+        _view_edges_count = edges_count;
+        _view_text = text;
+        _view_text_size = text_size;
+        _view_starts = starts;
+        _view_documents_count = documents_count;
+    }
 
-    explicit suffix_tree(const std::string &text):
-        _text(text + '$')
+    static bool consistent(const packed_node *nodes, std::size_t nodes_count, const packed_edge *edges, std::size_t edges_count,
+                           const std::int32_t *starts, std::size_t documents_count, std::size_t text_size) noexcept
     {
-        _nodes.emplace_back();
-        for (std::size_t i = 0; i < _text.size(); ++i)
+        auto text = static_cast<std::int64_t>(text_size);
+        for (std::size_t i = 0; i < documents_count; ++i)
         {
-            insert(i, _text.size() - 1);
+            if (starts[i] < (i == 0 ? 0 : starts[i - 1]) || starts[i] >= text || (i == 0 && starts[i] != 0))
+            {
+                return false;
+            }
         }
+
+        for (std::size_t i = 0; i < nodes_count; ++i)
+        {
+            const auto &node = nodes[i];
+            if (node.edges_begin < 0 || node.edges_begin > node.edges_end || static_cast<std::size_t>(node.edges_end) > edges_count)
+            {
+                return false;
+            }
+            if (i != 0 && (node.left < 0 || node.right < node.left - 1 || node.right >= text))
+            {
+                return false;
+            }
+            if (node.edges_begin == node.edges_end && i != 0 && (node.appear < 0 || node.appear >= text || node.first_appear != node.appear))
+            {
+                return false;
+            }
+        }
+
+        for (std::size_t i = 0; i < edges_count; ++i)
+        {
+            if (edges[i].child <= 0 || static_cast<std::size_t>(edges[i].child) >= nodes_count)
+            {
+                return false;
+            }
+        }
+        return true;
     }
 
-    std::vector<int> search(const std::string &pattern)
+    void unmap() noexcept
     {
-        if (pattern.size() == 0)
+        if (_mapping != nullptr)
         {
-            return {};
+            munmap(_mapping, _mapping_size);
+            _mapping = nullptr;
+            _mapping_size = 0;
         }
+    }
 
-        std::vector<int> result;
-        int node = 0, pattern_index = 0, size = pattern.size() - 1;
-        bool unequal = false;
-        while (pattern_index <= size)
+    int child(int current, char character) const
+    {
+        std::int32_t symbol = static_cast<unsigned char>(character);
+        auto begin = _view_edges + _view_nodes[current].edges_begin;
+        auto end = _view_edges + _view_nodes[current].edges_end;
+        auto it = std::lower_bound(begin, end, symbol, [](const packed_edge &edge, std::int32_t symbol)
+        {
+            return edge.symbol < symbol;
+        });
+        return it != end && it->symbol == symbol ? it->child : -1;
+    }
+
+    int locate(const std::string &pattern) const
+    {
+        if (_view_nodes_count == 0)
+        {
+            return -1;
+        }
+
+        int current = 0;
+        std::size_t pattern_index = 0;
+        while (pattern_index < pattern.size())
         {
-            if (node == 0)
+            current = child(current, pattern[pattern_index]);
+            if (current < 0)
             {
-                if (_nodes[node].children.find(pattern[pattern_index]) == _nodes[node].children.cend())
-                {
-                    break;
-                }
-                node = _nodes[node].children[pattern[pattern_index]];
+                return -1;
             }
 
-            for (int i = 0; _nodes[node].left + i <= _nodes[node].right && i + pattern_index <= size; ++i)
+            const auto &node = _view_nodes[current];
+            for (int i = node.left; i <= node.right && pattern_index < pattern.size(); ++i, ++pattern_index)
             {
-                if (pattern[pattern_index + i] == _text[_nodes[node].left + i])
+                if (pattern[pattern_index] != _view_text[i] || _view_text[i] == TERMINATOR)
                 {
-                    continue;
+                    return -1;
                 }
-                unequal = true;
-                break;
             }
+        }
+
+        return current;
+    }
 
-            if (unequal)
+    void dfs(std::vector<int> &appearances, int current) const
+    {
+        const auto &start = _view_nodes[current];
+        if (start.edges_begin == start.edges_end)
+        {
+            appearances.push_back(start.appear);
+            return;
+        }
+
+        appearances.reserve(appearances.size() + start.leaves);
+        std::vector<std::pair<int, int>> stack;
+        stack.reserve(start.leaves);
+        stack.emplace_back(start.edges_begin, start.edges_end);
+        while (!stack.empty())
+        {
+            auto &[edge, end] = stack.back();
+            if (edge == end)
             {
-                break;
+                stack.pop_back();
+                continue;
             }
 
-            pattern_index += _nodes[node].right - _nodes[node].left + 1;
-            if (pattern_index > size || _nodes[node].children.find(pattern[pattern_index]) == _nodes[node].children.cend())
+            const auto &node = _view_nodes[_view_edges[edge++].child];
+            if (node.edges_begin == node.edges_end)
             {
-                break;
+                appearances.push_back(node.appear);
             }
+            else
+            {
+                stack.emplace_back(node.edges_begin, node.edges_end);
+            }
+        }
+    }
+
+public:
+
+    struct hit
+    {
+        int document, offset;
+    };
 
-            node = _nodes[node].children[pattern[pattern_index]];
+    explicit suffix_tree() = default;
+
+    explicit suffix_tree(const std::string &text)
+    {
+        add_documents({text});
+    }
+
+    explicit suffix_tree(const std::vector<std::string> &documents)
+    {
+        add_documents(documents);
+    }
+
+    suffix_tree(const suffix_tree &other) = delete;
+    suffix_tree &operator=(const suffix_tree &other) = delete;
+
+    virtual ~suffix_tree()
+    {
+        unmap();
+    }
+
+    void add_documents(const std::vector<std::string> &documents)
+    {
+        INSTRUMENT_PHASE("suffix_tree.build");
+        for (const auto &document: documents)
+        {
+            if (document.find(TERMINATOR) != std::string::npos)
+            {
+                throw std::invalid_argument("Document contains terminator");
+            }
         }
 
-        if (pattern_index > size && !unequal)
+        if (_nodes.empty())
+        {
+            if (_view_nodes_count != 0)
+            {
+                unpack();
+            }
+            else
+            {
+                _nodes.emplace_back();
+            }
+        }
+
+        for (const auto &document: documents)
+        {
+            int start = _text.size();
+            _starts.push_back(start);
+            _text += document;
+            _text += TERMINATOR;
+
+            int right = _text.size() - 1;
+            for (int i = start; i <= right; ++i)
+            {
+                insert(i, right);
+            }
+        }
+        pack();
+    }
+
+    std::size_t documents_count() const noexcept
+    {
+        return _view_documents_count;
+    }
+
+    hit resolve(int position) const
+    {
+        auto start = std::upper_bound(_view_starts, _view_starts + _view_documents_count, position) - 1;
+        return {static_cast<int>(start - _view_starts), position - *start};
+    }
+
+    std::vector<int> search(const std::string &pattern) const
+    {
+        if (pattern.size() == 0)
+        {
+            return {};
+        }
+
+        std::vector<int> result;
+        auto node = locate(pattern);
+        if (node > 0)
         {
             dfs(result, node);
         }
+        INSTRUMENT_COUNT("suffix_tree.matches", result.size());
+        return result;
+    }
+
+    std::size_t count(const std::string &pattern) const
+    {
+        if (pattern.size() == 0)
+        {
+            return 0;
+        }
+
+        auto node = locate(pattern);
+        return node > 0 ? _view_nodes[node].leaves : 0;
+    }
+
+    std::vector<int> first(const std::string &pattern, std::size_t k) const
+    {
+        if (pattern.size() == 0)
+        {
+            return {};
+        }
+
+        std::vector<int> result;
+        auto node = locate(pattern);
+        if (node <= 0)
+        {
+            return result;
+        }
+
+        using entry = std::pair<int, int>;
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+        queue.emplace(_view_nodes[node].first_appear, node);
+        while (!queue.empty() && result.size() < k)
+        {
+            auto [appear, current] = queue.top();
+            queue.pop();
+
+            const auto &top = _view_nodes[current];
+            if (top.edges_begin == top.edges_end)
+            {
+                result.push_back(appear);
+                continue;
+            }
+
+            for (int i = top.edges_begin; i < top.edges_end; ++i)
+            {
+                auto child = _view_edges[i].child;
+                queue.emplace(_view_nodes[child].first_appear, child);
+            }
+        }
+
         return result;
     }
+
+    void save(const std::string &path) const
+    {
+        INSTRUMENT_PHASE("suffix_tree.save");
+        auto temporary = path + ".tmp";
+        std::ofstream ofs(temporary, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            throw std::runtime_error("Can't open " + temporary);
+        }
+
+        index_header header;
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.text_size = _view_text_size;
+        header.nodes_count = _view_nodes_count;
+        header.edges_count = _view_edges_count;
+        header.documents_count = _view_documents_count;
+
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(_view_nodes), sizeof(packed_node) * _view_nodes_count);
+        ofs.write(reinterpret_cast<const char *>(_view_edges), sizeof(packed_edge) * _view_edges_count);
+        ofs.write(reinterpret_cast<const char *>(_view_starts), sizeof(std::int32_t) * _view_documents_count);
+        ofs.write(_view_text, _view_text_size);
+        ofs.close();
+        if (!ofs)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Write error");
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Can't replace " + path);
+        }
+    }
+
+    void load(const std::string &path)
+    {
+        INSTRUMENT_PHASE("suffix_tree.load");
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Can't open " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(index_header))
+        {
+            close(fd);
+            throw std::runtime_error("Invalid index");
+        }
+
+        std::size_t size = info.st_size;
+        auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("Mapping error");
+        }
+
+        auto bytes = static_cast<const char *>(mapping);
+        const auto &header = *reinterpret_cast<const index_header *>(bytes);
+        auto nodes_offset = sizeof(index_header);
+        auto edges_offset = nodes_offset + sizeof(packed_node) * header.nodes_count;
+        auto starts_offset = edges_offset + sizeof(packed_edge) * header.edges_count;
+        auto text_offset = starts_offset + sizeof(std::int32_t) * header.documents_count;
+        if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.nodes_count == 0 ||
+            header.documents_count == 0 || header.nodes_count > size / sizeof(packed_node) ||
+            header.edges_count > size / sizeof(packed_edge) || header.documents_count > size / sizeof(std::int32_t) ||
+            header.text_size > size || text_offset + header.text_size != size ||
+            !consistent(reinterpret_cast<const packed_node *>(bytes + nodes_offset), header.nodes_count,
+                        reinterpret_cast<const packed_edge *>(bytes + edges_offset), header.edges_count,
+                        reinterpret_cast<const std::int32_t *>(bytes + starts_offset), header.documents_count, header.text_size))
+        {
+            munmap(mapping, size);
+            throw std::runtime_error("Invalid index");
+        }
+
+        unmap();
+        _nodes.clear();
+        _text.clear();
+        _starts.clear();
+        _packed_nodes.clear();
+        _packed_edges.clear();
+        _mapping = mapping;
+        _mapping_size = size;
+        view(reinterpret_cast<const packed_node *>(bytes + nodes_offset), header.nodes_count,
+             reinterpret_cast<const packed_edge *>(bytes + edges_offset), header.edges_count,
+             bytes + text_offset, header.text_size,
+             reinterpret_cast<const std::int32_t *>(bytes + starts_offset), header.documents_count);
+    }
 };
 
-int main()
+struct options
 {
-    std::string text;
-    std::getline(std::cin, text);
+    std::string build_path, index_path;
+    bool count = false;
+    std::size_t first = 0;
+    std::size_t threads = 1;
+    long documents = -1;
+};
 
-    suffix_tree tree(text);
+constexpr std::size_t BATCH_SIZE = 1 << 16;
 
-    std::string pattern;
-    int lines_count = 1;
-    while (std::getline(std::cin, pattern))
+options parse_options(int argc, char *argv[])
+{
+    options result;
+    for (int i = 1; i < argc; ++i)
     {
-        auto indices = tree.search(pattern);
-        if (pattern.empty() || indices.empty())
+        std::string argument = argv[i];
+        if (argument == "--count")
         {
-            lines_count++;
+            result.count = true;
             continue;
         }
-        std::sort(indices.begin(), indices.end());
-        std::cout << lines_count << ": ";
-        for (std::size_t i = 0; i < indices.size(); i++)
+
+        if (i + 1 == argc)
+        {
+            throw std::invalid_argument("Usage: lab5 [--index <index>] [--documents <k>] [--build <index>] [--count | --first <k>] [--threads <n>]\n"
+                                        "Appending to an --index rebuilds the whole index, so pass every new document in one run with --documents <k>");
+        }
+
+        if (argument == "--build")
         {
-            std::cout << indices[i] + 1;
-            if (i != indices.size() - 1)
+            result.build_path = argv[++i];
+        }
+        else if (argument == "--index")
+        {
+            result.index_path = argv[++i];
+        }
+        else if (argument == "--first")
+        {
+            result.first = std::stoul(argv[++i]);
+        }
+        else if (argument == "--documents")
+        {
+            result.documents = std::stol(argv[++i]);
+        }
+        else if (argument == "--threads")
+        {
+            result.threads = std::stoul(argv[++i]);
+            if (result.threads == 0)
             {
-                std::cout << ", ";
+                result.threads = std::max(1u, std::thread::hardware_concurrency());
             }
         }
-        std::cout << std::endl;
-        lines_count++;
+        else
+        {
+            throw std::invalid_argument("Unknown option " + argument);
+        }
+    }
+
+    return result;
+}
+
+std::string answer(const suffix_tree &tree, const std::string &pattern, int line_number, const options &opts)
+{
+    if (opts.count)
+    {
+        auto count = tree.count(pattern);
+        return count != 0 ? std::to_string(line_number) + ": " + std::to_string(count) + '\n' : "";
+    }
+
+    auto indices = opts.first != 0 ? tree.first(pattern, opts.first) : tree.search(pattern);
+    if (pattern.empty() || indices.empty())
+    {
+        return "";
+    }
+
+    std::sort(indices.begin(), indices.end());
+    std::string result = std::to_string(line_number) + ": ";
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        if (tree.documents_count() > 1)
+        {
+            auto hit = tree.resolve(indices[i]);
+            result += std::to_string(hit.document + 1) + ':' + std::to_string(hit.offset + 1);
+        }
+        else
+        {
+            result += std::to_string(indices[i] + 1);
+        }
+        if (i != indices.size() - 1)
+        {
+            result += ", ";
+        }
+    }
+    result += '\n';
+    return result;
+}
+
+void answer_batch(const suffix_tree &tree, const std::vector<std::string> &patterns, int first_line, const options &opts, fast_io::writer &output)
+{
+    std::vector<std::string> answers(patterns.size());
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]()
+    {
+        for (auto i = next++; i < patterns.size(); i = next++)
+        {
+            answers[i] = answer(tree, patterns[i], first_line + i, opts);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < opts.threads; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: pool)
+    {
+        thread.join();
+    }
+
+    for (const auto &line: answers)
+    {
+        output.write(line);
+    }
+}
+
+void answer_queries(const suffix_tree &tree, const options &opts, fast_io::reader &input, fast_io::writer &output)
+{
+    INSTRUMENT_PHASE("lab5.queries");
+    std::string pattern;
+    int lines_count = 1;
+    if (opts.threads <= 1)
+    {
+        while (input.read_line(pattern))
+        {
+            output.write(answer(tree, pattern, lines_count++, opts));
+        }
+        return;
+    }
+
+    std::vector<std::string> patterns;
+    patterns.reserve(BATCH_SIZE);
+    while (input.read_line(pattern))
+    {
+        patterns.push_back(std::move(pattern));
+        if (patterns.size() == BATCH_SIZE)
+        {
+            answer_batch(tree, patterns, lines_count, opts, output);
+            lines_count += patterns.size();
+            patterns.clear();
+        }
+    }
+    answer_batch(tree, patterns, lines_count, opts, output);
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        auto opts = parse_options(argc, argv);
+        fast_io::reader input;
+        fast_io::writer output;
+        suffix_tree tree;
+        if (!opts.index_path.empty())
+        {
+            tree.load(opts.index_path);
+        }
+
+        std::vector<std::string> documents(opts.documents >= 0 ? opts.documents : opts.index_path.empty());
+        for (auto &document: documents)
+        {
+            input.read_line(document);
+        }
+        if (!documents.empty())
+        {
+            tree.add_documents(documents);
+        }
+
+        if (!opts.build_path.empty())
+        {
+            tree.save(opts.build_path);
+            return 0;
+        }
+
+        answer_queries(tree, opts, input, output);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "ERROR: " << exception.what() << std::endl;
+        return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
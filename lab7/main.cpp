@@ -1,11 +1,15 @@
-#include <iostream>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <unordered_map>
+
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
 
 std::pair<int, std::uint64_t> get_value_operation_pair(
-    std::uint64_t minus_one, 
-    std::uint64_t div_by_two, 
+    std::uint64_t minus_one,
+    std::uint64_t div_by_two,
     std::uint64_t div_by_three)
 {
     if (minus_one <= std::min(div_by_two, div_by_three))
@@ -19,48 +23,111 @@ std::pair<int, std::uint64_t> get_value_operation_pair(
     return std::make_pair(3, div_by_three);
 }
 
-int main()
+class reducer
 {
-    int input;
-    std::cin >> input;
-    std::vector<std::uint64_t> dp(input + 1, 0);
-    std::vector<int> prev(input + 1, -1);
+private:
+    static constexpr std::size_t TABLE_LIMIT = 1 << 22;
+
+    std::vector<std::uint64_t> _table = {0, 0};
+    std::unordered_map<std::uint64_t, std::uint64_t> _memo;
+
+    void extend(std::uint64_t n)
+    {
+        INSTRUMENT_PHASE("reducer.extend");
+        std::size_t size = std::min<std::uint64_t>(n + 1, TABLE_LIMIT);
+        for (std::size_t i = _table.size(); i < size; i++)
+        {
+            _table.push_back(i + get_value_operation_pair(
+                _table[i - 1],
+                i % 2 == 0 ? _table[i / 2] : UINT64_MAX,
+                i % 3 == 0 ? _table[i / 3] : UINT64_MAX).second);
+        }
+    }
+
+    std::uint64_t cost(std::uint64_t n)
+    {
+        if (n < _table.size())
+        {
+            return _table[n];
+        }
+
+        auto found = _memo.find(n);
+        if (found != _memo.end())
+        {
+            return found->second;
+        }
+
+        std::uint64_t even = n - n % 2;
+        std::uint64_t by_two = (n % 2 == 1 ? n : 0) + even + cost(even / 2);
 
-    dp[1] = 0;
+        std::uint64_t triple = n - n % 3;
+        std::uint64_t skipped = n % 3 == 0 ? 0 : n % 3 == 1 ? n : 2 * n - 1;
+        std::uint64_t by_three = skipped + triple + cost(triple / 3);
 
-    for (std::size_t i = 2; i <= input; i++)
+        return _memo[n] = std::min(by_two, by_three);
+    }
+
+    std::string path(std::uint64_t n)
     {
-        auto pair = get_value_operation_pair(
-            dp[i - 1], 
-            i % 2 == 0 ? dp[i / 2] : UINT64_MAX, 
-            i % 3 == 0 ? dp[i / 3] : UINT64_MAX);
+        std::string result;
+        while (n > 1)
+        {
+            auto pair = get_value_operation_pair(
+                cost(n - 1),
+                n % 2 == 0 ? cost(n / 2) : UINT64_MAX,
+                n % 3 == 0 ? cost(n / 3) : UINT64_MAX);
+
+            switch (pair.first)
+            {
+            case 1:
+                result += "-1";
+                n--;
+                break;
+            case 2:
+                result += "/2";
+                n /= 2;
+                break;
+            case 3:
+                result += "/3";
+                n /= 3;
+                break;
+            }
 
-        prev[i] = pair.first;
-        dp[i] = i + pair.second;
+            result += n != 1 ? ' ' : '\n';
+        }
+        return result;
     }
 
-    std::cout << dp[input] << std::endl;
+public:
+    std::string solve(std::uint64_t n)
+    {
+        extend(n);
+
+        INSTRUMENT_PHASE("reducer.solve");
+        auto result = std::to_string(cost(n)) + '\n' + path(n);
+        INSTRUMENT_COUNT("reducer.memo_states", _memo.size());
+        _memo.clear();
+        return result;
+    }
+};
 
-    while (input != 1) 
+int main(int argc, char *argv[])
+{
+    bool batch = argc > 1 && std::string(argv[1]) == "--batch";
+
+    fast_io::reader input;
+    fast_io::writer output;
+
+    reducer solver;
+    std::uint64_t n;
+    while (input.read(n))
     {
-        switch (prev[input])
+        output.write(solver.solve(n));
+        if (!batch)
         {
-        case 1:
-            std::cout << "-1";
-            input--;
-            break;
-        case 2:
-            std::cout << "/2";
-            input /= 2;
-            break;
-        case 3:
-            std::cout << "/3";
-            input /= 3;
             break;
         }
-
-        std::cout << (input != 1 ? ' ' : '\n');
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -2,11 +2,21 @@
 #include <vector>
 #include <queue>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
-using graph = std::vector<std::vector<int>>;
+#include "../common/csr_graph.hpp"
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
+
+using graph = csr_graph<int>;
 
 std::vector<int> topological_sort(const graph &adj, std::vector<int> &indegree)
 {
+    INSTRUMENT_PHASE("topological_sort");
     std::queue<int> queue;
     for (std::size_t i = 1; i < adj.size(); i++)
     {
@@ -36,36 +46,580 @@ std::vector<int> topological_sort(const graph &adj, std::vector<int> &indegree)
     return result;
 }
 
-int main()
+std::vector<int> strongly_connected_components(const graph &adj, int &count)
 {
-    int n, m;
-    std::cin >> n >> m;
+    INSTRUMENT_PHASE("strongly_connected_components");
+    struct frame
+    {
+        int node;
+        const int *next;
+    };
 
-    graph adj(n + 1);
-    std::vector<int> indegree(n + 1, 0);
+    std::vector<int> component(adj.size(), -1), index(adj.size(), -1), low(adj.size(), 0);
+    std::vector<int> stack;
+    std::vector<frame> calls;
+    int counter = 0;
+    count = 0;
+
+    for (std::size_t root = 1; root < adj.size(); root++)
+    {
+        if (index[root] != -1)
+        {
+            continue;
+        }
+
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        calls.push_back({static_cast<int>(root), adj[root].begin()});
+        while (!calls.empty())
+        {
+            auto &top = calls.back();
+            auto node = top.node;
+            if (top.next != adj[node].end())
+            {
+                auto neighbor = *top.next++;
+                if (index[neighbor] == -1)
+                {
+                    index[neighbor] = low[neighbor] = counter++;
+                    stack.push_back(neighbor);
+                    calls.push_back({neighbor, adj[neighbor].begin()});
+                }
+                else if (component[neighbor] == -1)
+                {
+                    low[node] = std::min(low[node], index[neighbor]);
+                }
+                continue;
+            }
+
+            calls.pop_back();
+            if (!calls.empty())
+            {
+                auto parent = calls.back().node;
+                low[parent] = std::min(low[parent], low[node]);
+            }
+
+            if (low[node] == index[node])
+            {
+                int member;
+                do
+                {
+                    member = stack.back();
+                    stack.pop_back();
+                    component[member] = count;
+                } while (member != node);
+                count++;
+            }
+        }
+    }
+
+    for (std::size_t i = 1; i < adj.size(); i++)
+    {
+        component[i] = count - 1 - component[i];
+    }
+    return component;
+}
+
+std::vector<int> find_cycle(const graph &adj, const std::vector<int> &component)
+{
+    std::vector<int> size(adj.size(), 0);
+    for (std::size_t i = 1; i < adj.size(); i++)
+    {
+        size[component[i]]++;
+    }
+
+    for (std::size_t start = 1; start < adj.size(); start++)
+    {
+        for (const auto &neighbor: adj[start])
+        {
+            if (neighbor == static_cast<int>(start))
+            {
+                return {neighbor, neighbor};
+            }
+        }
+
+        if (size[component[start]] < 2)
+        {
+            continue;
+        }
+
+        std::vector<int> parent(adj.size(), 0);
+        std::queue<int> queue;
+        queue.push(start);
+        parent[start] = start;
+        while (!queue.empty())
+        {
+            auto node = queue.front();
+            queue.pop();
+            for (const auto &neighbor: adj[node])
+            {
+                if (component[neighbor] != component[start])
+                {
+                    continue;
+                }
+
+                if (neighbor == static_cast<int>(start))
+                {
+                    std::vector<int> cycle = {neighbor};
+                    for (auto current = node; current != static_cast<int>(start); current = parent[current])
+                    {
+                        cycle.push_back(current);
+                    }
+                    cycle.push_back(neighbor);
+                    std::reverse(cycle.begin(), cycle.end());
+                    return cycle;
+                }
 
-    for (int i = 0; i < m; ++i) 
+                if (parent[neighbor] == 0)
+                {
+                    parent[neighbor] = node;
+                    queue.push(neighbor);
+                }
+            }
+        }
+    }
+
+    return {};
+}
+
+void print_condensation(const graph &adj, fast_io::writer &output)
+{
+    int count;
+    auto component = strongly_connected_components(adj, count);
+
+    auto cycle = find_cycle(adj, component);
+    output.write("cycle:");
+    if (cycle.empty())
+    {
+        output.write(" none");
+    }
+    for (const auto &node: cycle)
+    {
+        output.write(' ');
+        output.write(node);
+    }
+    output.write('\n');
+
+    std::vector<std::vector<int>> members(count);
+    for (std::size_t i = 1; i < adj.size(); i++)
+    {
+        members[component[i]].push_back(i);
+    }
+
+    output.write("components: ");
+    output.write(count);
+    output.write('\n');
+    for (const auto &list: members)
+    {
+        for (const auto &node: list)
+        {
+            output.write(node);
+            output.write(' ');
+        }
+        output.write('\n');
+    }
+
+    std::vector<std::pair<int, int>> edges;
+    for (std::size_t i = 1; i < adj.size(); i++)
+    {
+        for (const auto &neighbor: adj[i])
+        {
+            if (component[i] != component[neighbor])
+            {
+                edges.emplace_back(component[i] + 1, component[neighbor] + 1);
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    output.write("condensation: ");
+    output.write(edges.size());
+    output.write('\n');
+    for (const auto &edge: edges)
+    {
+        output.write(edge.first);
+        output.write(' ');
+        output.write(edge.second);
+        output.write('\n');
+    }
+}
+
+constexpr std::size_t PARALLEL_FRONTIER = 4096;
+
+std::vector<int> parallel_topological_sort(const graph &adj, const std::vector<int> &indegree, std::size_t threads, bool smallest_first)
+{
+    INSTRUMENT_PHASE("parallel_topological_sort");
+    std::vector<std::atomic<int>> remaining(adj.size());
+    std::vector<int> frontier;
+    for (std::size_t i = 1; i < adj.size(); i++)
+    {
+        remaining[i].store(indegree[i], std::memory_order_relaxed);
+        if (indegree[i] == 0)
+        {
+            frontier.push_back(i);
+        }
+    }
+
+    std::vector<int> result;
+    result.reserve(adj.size());
+    std::vector<std::vector<int>> next(threads);
+
+    while (!frontier.empty())
+    {
+        INSTRUMENT_COUNT("parallel_topological_sort.levels", 1);
+        if (smallest_first)
+        {
+            std::sort(frontier.begin(), frontier.end());
+        }
+        result.insert(result.end(), frontier.begin(), frontier.end());
+
+        auto workers = frontier.size() < PARALLEL_FRONTIER ? 1 : threads;
+        auto expand = [&](std::size_t part)
+        {
+            auto &found = next[part];
+            found.clear();
+            for (auto i = frontier.size() * part / workers; i < frontier.size() * (part + 1) / workers; i++)
+            {
+                for (const auto &neighbor: adj[frontier[i]])
+                {
+                    if (remaining[neighbor].fetch_sub(1, std::memory_order_relaxed) == 1)
+                    {
+                        found.push_back(neighbor);
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (std::size_t part = 1; part < workers; part++)
+        {
+            pool.emplace_back(expand, part);
+        }
+        expand(0);
+        for (auto &thread: pool)
+        {
+            thread.join();
+        }
+
+        frontier.clear();
+        for (std::size_t part = 0; part < workers; part++)
+        {
+            frontier.insert(frontier.end(), next[part].begin(), next[part].end());
+        }
+    }
+
+    return result;
+}
+
+class incremental_order
+{
+private:
+    std::vector<std::vector<int>> _out, _in;
+    std::vector<int> _order, _nodes;
+    std::vector<bool> _visited;
+    std::vector<int> _forward, _backward, _stack;
+
+    bool search_forward(int from, int upper)
+    {
+        _stack.assign(1, from);
+        _visited[from] = true;
+        while (!_stack.empty())
+        {
+            auto node = _stack.back();
+            _stack.pop_back();
+            _forward.push_back(node);
+            for (auto neighbor: _out[node])
+            {
+                if (_order[neighbor] == upper)
+                {
+                    return false;
+                }
+                if (!_visited[neighbor] && _order[neighbor] < upper)
+                {
+                    _visited[neighbor] = true;
+                    _stack.push_back(neighbor);
+                }
+            }
+        }
+        return true;
+    }
+
+    void search_backward(int from, int lower)
+    {
+        _stack.assign(1, from);
+        _visited[from] = true;
+        while (!_stack.empty())
+        {
+            auto node = _stack.back();
+            _stack.pop_back();
+            _backward.push_back(node);
+            for (auto neighbor: _in[node])
+            {
+                if (!_visited[neighbor] && _order[neighbor] > lower)
+                {
+                    _visited[neighbor] = true;
+                    _stack.push_back(neighbor);
+                }
+            }
+        }
+    }
+
+    void reorder()
+    {
+        INSTRUMENT_COUNT("pearce_kelly.reorders", 1);
+        INSTRUMENT_COUNT("pearce_kelly.reordered_nodes", _forward.size() + _backward.size());
+        auto by_order = [this](int first, int second)
+        {
+            return _order[first] < _order[second];
+        };
+        std::sort(_forward.begin(), _forward.end(), by_order);
+        std::sort(_backward.begin(), _backward.end(), by_order);
+
+        std::vector<int> slots;
+        slots.reserve(_forward.size() + _backward.size());
+        for (auto node: _backward)
+        {
+            slots.push_back(_order[node]);
+            _visited[node] = false;
+        }
+        for (auto node: _forward)
+        {
+            slots.push_back(_order[node]);
+            _visited[node] = false;
+        }
+        std::inplace_merge(slots.begin(), slots.begin() + _backward.size(), slots.end());
+
+        std::size_t i = 0;
+        for (auto node: _backward)
+        {
+            _order[node] = slots[i++];
+            _nodes[_order[node]] = node;
+        }
+        for (auto node: _forward)
+        {
+            _order[node] = slots[i++];
+            _nodes[_order[node]] = node;
+        }
+    }
+
+public:
+    explicit incremental_order(int n):
+        _out(n + 1),
+        _in(n + 1),
+        _order(n + 1),
+        _nodes(n + 1),
+        _visited(n + 1, false)
+    {
+        for (int i = 0; i <= n; i++)
+        {
+            _order[i] = _nodes[i] = i;
+        }
+    }
+
+    bool add_edge(int from, int to)
+    {
+        if (from == to)
+        {
+            return false;
+        }
+
+        auto lower = _order[to], upper = _order[from];
+        if (lower < upper)
+        {
+            _forward.clear();
+            _backward.clear();
+            if (!search_forward(to, upper))
+            {
+                for (auto node: _forward)
+                {
+                    _visited[node] = false;
+                }
+                for (auto node: _stack)
+                {
+                    _visited[node] = false;
+                }
+                return false;
+            }
+            search_backward(from, lower);
+            reorder();
+        }
+
+        _out[from].push_back(to);
+        _in[to].push_back(from);
+        return true;
+    }
+
+    std::vector<int> order() const
+    {
+        return std::vector<int>(_nodes.begin() + 1, _nodes.end());
+    }
+};
+
+int run_online(int n, int m, bool stats, fast_io::reader &input, fast_io::writer &output)
+{
+    INSTRUMENT_PHASE("lab8.online");
+    using clock = std::chrono::steady_clock;
+
+    incremental_order order(n);
+    std::vector<int> edges;
+    if (stats)
+    {
+        edges.reserve(2 * static_cast<std::size_t>(m));
+    }
+
+    std::chrono::duration<double> update_time(0);
+    for (int i = 0; i < m; ++i)
     {
         int a, b;
-        std::cin >> a >> b;
-        adj[a].push_back(b);
-        indegree[b]++;
+        input.read(a);
+        input.read(b);
+
+        auto start = stats ? clock::now() : clock::time_point();
+        auto accepted = order.add_edge(a, b);
+        if (stats)
+        {
+            update_time += clock::now() - start;
+        }
+        if (!accepted)
+        {
+            output.write("-1\n");
+            output.flush();
+            return 0;
+        }
+
+        if (stats)
+        {
+            edges.push_back(a);
+            edges.push_back(b);
+        }
+    }
+
+    for (const auto &node: order.order())
+    {
+        output.write(node);
+        output.write(' ');
+    }
+    output.write('\n');
+    output.flush();
+
+    if (stats)
+    {
+        std::vector<int> indegree(n + 1, 0);
+        for (std::size_t i = 1; i < edges.size(); i += 2)
+        {
+            indegree[edges[i]]++;
+        }
+
+        auto start = clock::now();
+        std::size_t next = 0;
+        graph adj(n + 1, edges.size() / 2, [&edges, &next](int &from, int &to)
+        {
+            from = edges[next++];
+            to = edges[next++];
+        });
+        topological_sort(adj, indegree);
+        std::chrono::duration<double> full_time = clock::now() - start;
+
+        std::cerr << "online: " << update_time.count() << " s, " << (m != 0 ? update_time.count() / m * 1e6 : 0.0) << " us/edge"
+                  << ", full recomputation: " << full_time.count() << " s" << std::endl;
     }
 
-    auto result = topological_sort(adj, indegree);
+    return 0;
+}
+
+struct options
+{
+    std::size_t threads = 0;
+    bool smallest_first = false;
+    bool online = false;
+    bool stats = false;
+    bool scc = false;
+};
 
-    if (result.size() != n)
+options parse_options(int argc, char *argv[])
+{
+    options result;
+    for (int i = 1; i < argc; ++i)
     {
-        std::cout << -1 << std::endl;
+        std::string argument = argv[i];
+        if (argument == "--smallest" || argument == "--online" || argument == "--stats" || argument == "--scc")
+        {
+            (argument == "--smallest" ? result.smallest_first : argument == "--online" ? result.online : argument == "--stats" ? result.stats : result.scc) = true;
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            result.threads = std::stoul(argv[++i]);
+            if (result.threads == 0)
+            {
+                result.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Usage: lab8 [--threads <n>] [--smallest] [--online [--stats]] [--scc]");
+        }
+    }
+
+    if (result.smallest_first && result.threads == 0)
+    {
+        result.threads = 1;
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    options opts;
+    try
+    {
+        opts = parse_options(argc, argv);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "ERROR: " << exception.what() << std::endl;
+        return 1;
+    }
+
+    fast_io::reader input;
+    fast_io::writer output;
+
+    int n = 0, m = 0;
+    input.read(n);
+    input.read(m);
+
+    if (opts.online)
+    {
+        return run_online(n, m, opts.stats, input, output);
+    }
+
+    std::vector<int> indegree(n + 1, 0);
+    graph adj(n + 1, m, [&input, &indegree](int &from, int &to)
+    {
+        input.read(from);
+        input.read(to);
+        indegree[to]++;
+    });
+
+    if (opts.scc)
+    {
+        print_condensation(adj, output);
         return 0;
     }
 
-    for (const auto &node: result)
+    auto result = opts.threads == 0 ? topological_sort(adj, indegree) : parallel_topological_sort(adj, indegree, opts.threads, opts.smallest_first);
+
+    if (result.size() != static_cast<std::size_t>(n))
     {
-        std::cout << node << " ";
+        output.write("-1\n");
+        return 0;
     }
 
-    std::cout << std::endl;
+    for (const auto &node: result)
+    {
+        output.write(node);
+        output.write(' ');
+    }
+    output.write('\n');
 
     return 0;
 }
\ No newline at end of file
@@ -2,71 +2,356 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
-using graph_t = std::vector<std::vector<std::uint32_t>>;
+#include "../common/csr_graph.hpp"
+#include "../common/fast_io.hpp"
+#include "../common/instrument.hpp"
 
-void dfs(std::uint32_t from, std::uint32_t &current_component, std::vector<std::uint32_t> &components, const graph_t &graph)
+using graph_t = csr_graph<std::uint32_t>;
+
+void dfs(std::uint32_t from, std::uint32_t current_component, std::vector<std::uint32_t> &components, const graph_t &graph, std::vector<std::uint32_t> &stack)
 {
     components[from] = current_component;
-    for (std::uint32_t to: graph[from])
+    stack.push_back(from);
+    while (!stack.empty())
     {
-        if (components[to] == 0)
+        auto vertex = stack.back();
+        stack.pop_back();
+        for (std::uint32_t to: graph[vertex])
         {
-            dfs(to, current_component, components, graph);
+            if (components[to] == 0)
+            {
+                components[to] = current_component;
+                stack.push_back(to);
+            }
         }
     }
 }
 
-int main() 
+class disjoint_set
 {
-    std::uint32_t n, m;
-    std::cin >> n >> m;
-    
-    graph_t graph(n + 1);
-    
-    for (std::uint32_t i = 0; i < m; ++i)
+private:
+    std::vector<std::uint32_t> _parent, _size;
+
+public:
+    explicit disjoint_set(std::size_t n):
+        _parent(n),
+        _size(n, 1)
     {
-        std::uint32_t from, to;
-        std::cin >> from >> to;
-        graph[from].push_back(to);
-        graph[to].push_back(from);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            _parent[i] = i;
+        }
     }
 
-    std::vector<std::uint32_t> components(n + 1);
+    std::uint32_t find(std::uint32_t vertex) noexcept
+    {
+        auto root = vertex;
+        while (_parent[root] != root)
+        {
+            root = _parent[root];
+        }
+
+        while (_parent[vertex] != root)
+        {
+            auto next = _parent[vertex];
+            _parent[vertex] = root;
+            vertex = next;
+        }
+        return root;
+    }
+
+    void unite(std::uint32_t first, std::uint32_t second) noexcept
+    {
+        first = find(first);
+        second = find(second);
+        if (first == second)
+        {
+            return;
+        }
+
+        if (_size[first] < _size[second])
+        {
+            std::swap(first, second);
+        }
+        INSTRUMENT_COUNT("disjoint_set.unions", 1);
+        _parent[second] = first;
+        _size[first] += _size[second];
+    }
+};
+
+graph_t read_graph(std::uint32_t n, std::uint32_t m, fast_io::reader &input)
+{
+    return graph_t(n + 1, m, [&input](std::uint32_t &from, std::uint32_t &to)
+    {
+        input.read(from);
+        input.read(to);
+    }, true);
+}
+
+std::uint32_t label_by_search(std::uint32_t n, std::uint32_t m, std::vector<std::uint32_t> &components, fast_io::reader &input)
+{
+    INSTRUMENT_PHASE("label_by_search");
+    auto graph = read_graph(n, m, input);
+
     std::uint32_t components_count = 0;
+    std::vector<std::uint32_t> stack;
+    stack.reserve(n);
 
     for (std::uint32_t i = 1; i < n + 1; ++i)
     {
         if (components[i] == 0)
         {
-            dfs(i, ++components_count, components, graph);
+            dfs(i, ++components_count, components, graph, stack);
+        }
+    }
+    return components_count;
+}
+
+std::uint32_t label_by_stream(std::uint32_t n, std::uint32_t m, std::vector<std::uint32_t> &components, fast_io::reader &input)
+{
+    INSTRUMENT_PHASE("label_by_stream");
+    disjoint_set set(n + 1);
+    for (std::uint32_t i = 0; i < m; ++i)
+    {
+        std::uint32_t from = 0, to = 0;
+        input.read(from);
+        input.read(to);
+        set.unite(from, to);
+    }
+
+    std::uint32_t components_count = 0;
+    for (std::uint32_t i = 1; i < n + 1; ++i)
+    {
+        auto root = set.find(i);
+        if (components[root] == 0)
+        {
+            components[root] = ++components_count;
+        }
+        components[i] = components[root];
+    }
+    return components_count;
+}
+
+constexpr std::uint32_t NEIGHBOR_ROUNDS = 2;
+constexpr std::size_t SAMPLES = 1024;
+
+template<typename Body>
+void parallel_for(std::size_t n, std::size_t threads, Body body)
+{
+    std::vector<std::thread> pool;
+    for (std::size_t part = 1; part < threads; ++part)
+    {
+        pool.emplace_back(body, n * part / threads, n * (part + 1) / threads);
+    }
+    body(0, n / threads);
+    for (auto &thread: pool)
+    {
+        thread.join();
+    }
+}
+
+void link(std::uint32_t first, std::uint32_t second, std::vector<std::atomic<std::uint32_t>> &parent) noexcept
+{
+    auto first_root = parent[first].load(std::memory_order_relaxed);
+    auto second_root = parent[second].load(std::memory_order_relaxed);
+    while (first_root != second_root)
+    {
+        auto high = std::max(first_root, second_root);
+        auto low = std::min(first_root, second_root);
+        auto high_parent = parent[high].load(std::memory_order_relaxed);
+        if (high_parent == low)
+        {
+            break;
+        }
+        if (high_parent == high && parent[high].compare_exchange_strong(high_parent, low, std::memory_order_relaxed))
+        {
+            break;
+        }
+        first_root = parent[parent[high].load(std::memory_order_relaxed)].load(std::memory_order_relaxed);
+        second_root = parent[low].load(std::memory_order_relaxed);
+    }
+}
+
+void compress(std::vector<std::atomic<std::uint32_t>> &parent, std::size_t threads)
+{
+    parallel_for(parent.size(), threads, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto vertex = begin; vertex < end; ++vertex)
+        {
+            auto current = parent[vertex].load(std::memory_order_relaxed);
+            while (current != parent[current].load(std::memory_order_relaxed))
+            {
+                current = parent[current].load(std::memory_order_relaxed);
+                parent[vertex].store(current, std::memory_order_relaxed);
+            }
         }
+    });
+}
+
+std::uint32_t label_by_afforest(std::uint32_t n, std::uint32_t m, std::vector<std::uint32_t> &components, std::size_t threads, fast_io::reader &input)
+{
+    INSTRUMENT_PHASE("label_by_afforest");
+    auto graph = read_graph(n, m, input);
+
+    std::vector<std::atomic<std::uint32_t>> parent(n + 1);
+    for (std::uint32_t i = 0; i < n + 1; ++i)
+    {
+        parent[i].store(i, std::memory_order_relaxed);
     }
 
-    std::vector<std::vector<std::uint32_t>> result(components_count);
-    for (std::uint32_t i = 1; i < components.size(); ++i)
+    for (std::uint32_t round = 0; round < NEIGHBOR_ROUNDS; ++round)
     {
-        result[components[i] - 1].push_back(i);
+        parallel_for(parent.size(), threads, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto vertex = begin; vertex < end; ++vertex)
+            {
+                auto neighbors = graph[vertex];
+                if (neighbors.end() - neighbors.begin() > round)
+                {
+                    link(vertex, neighbors.begin()[round], parent);
+                }
+            }
+        });
+        compress(parent, threads);
     }
 
-    for (auto &component: result)
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<std::uint32_t> distribution(1, std::max<std::uint32_t>(n, 1));
+    std::unordered_map<std::uint32_t, std::size_t> frequency;
+    std::uint32_t largest = 0;
+    for (std::size_t i = 0; n != 0 && i < SAMPLES; ++i)
     {
-        std::sort(component.begin(), component.end());
+        auto root = parent[distribution(generator)].load(std::memory_order_relaxed);
+        auto seen = ++frequency[root];
+        if (seen > frequency[largest])
+        {
+            largest = root;
+        }
     }
 
-    std::sort(result.begin(), result.end(), [](const auto &first, const auto &second)
+    parallel_for(parent.size(), threads, [&](std::size_t begin, std::size_t end)
     {
-        return first[0] < second[0];
+        for (auto vertex = begin; vertex < end; ++vertex)
+        {
+            if (parent[vertex].load(std::memory_order_relaxed) == largest)
+            {
+                continue;
+            }
+
+            auto neighbors = graph[vertex];
+            for (auto to = neighbors.begin() + std::min<std::ptrdiff_t>(NEIGHBOR_ROUNDS, neighbors.end() - neighbors.begin()); to != neighbors.end(); ++to)
+            {
+                link(vertex, *to, parent);
+            }
+        }
     });
+    compress(parent, threads);
 
-    for (const auto &component: result)
+    std::uint32_t components_count = 0;
+    for (std::uint32_t i = 1; i < n + 1; ++i)
     {
-        for (std::size_t i = 0; i < component.size(); ++i)
+        auto root = parent[i].load(std::memory_order_relaxed);
+        components[i] = root == i ? ++components_count : components[root];
+    }
+    return components_count;
+}
+
+void print_components(const std::vector<std::uint32_t> &components, std::uint32_t components_count, fast_io::writer &output)
+{
+    INSTRUMENT_PHASE("print_components");
+    std::vector<std::size_t> offsets(components_count + 2, 0);
+    for (std::size_t i = 1; i < components.size(); ++i)
+    {
+        offsets[components[i]]++;
+    }
+
+    for (std::size_t i = 1; i < offsets.size(); ++i)
+    {
+        offsets[i] += offsets[i - 1];
+    }
+
+    std::vector<std::uint32_t> vertices(components.size() - 1);
+    for (auto i = components.size() - 1; i > 0; --i)
+    {
+        vertices[--offsets[components[i]]] = i;
+    }
+
+    for (std::uint32_t component = 1; component <= components_count; ++component)
+    {
+        for (auto i = offsets[component]; i < offsets[component + 1]; ++i)
         {
-            std::cout << component[i] << " "; 
+            output.write(vertices[i]);
+            output.write(' ');
         }
-        std::cout << std::endl;
+        output.write('\n');
     }
+}
+
+struct options
+{
+    bool stream = false;
+    std::size_t threads = 0;
+};
+
+options parse_options(int argc, char *argv[])
+{
+    options result;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--stream")
+        {
+            result.stream = true;
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            result.threads = std::stoul(argv[++i]);
+            if (result.threads == 0)
+            {
+                result.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Usage: lab9 [--stream | --threads <n>]");
+        }
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    options opts;
+    try
+    {
+        opts = parse_options(argc, argv);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "ERROR: " << exception.what() << std::endl;
+        return 1;
+    }
+
+    fast_io::reader input;
+    fast_io::writer output;
+
+    std::uint32_t n = 0, m = 0;
+    input.read(n);
+    input.read(m);
+
+    std::vector<std::uint32_t> components(n + 1);
+    auto components_count = opts.stream ? label_by_stream(n, m, components, input) :
+                            opts.threads != 0 ? label_by_afforest(n, m, components, opts.threads, input) :
+                            label_by_search(n, m, components, input);
+
+    print_components(components, components_count, output);
 
     return 0;
 }
\ No newline at end of file